@@ -234,7 +234,7 @@ void DevenvStepConfigWidget::updateDetails()
         QString args;
         QString cmd;
         auto project = static_cast<VsProject*>(bc->target()->project());
-        if (project) {
+        if (project && project->vsProjectData()) {
             if (m_devenvStep->m_clean) {
                 project->vsProjectData()->cleanCmd(bc->displayName(), &cmd, &args);
             } else {
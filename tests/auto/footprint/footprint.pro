@@ -0,0 +1,4 @@
+include(../../vsmodel.pri)
+
+SOURCES += \
+    tst_footprint.cpp
@@ -0,0 +1,133 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#include "vsprojectdata.h"
+#include "vsstringpool.h"
+#include "vstestprojects.h"
+
+#include <QScopedPointer>
+#include <QSet>
+#include <QTemporaryDir>
+#include <QtTest>
+
+using namespace VsProjectManager::Internal;
+
+Q_DECLARE_METATYPE(VsProjectData::ParserType)
+
+namespace {
+
+const int ItemCount = 10000;
+// What a project may add to the pool besides its items, e.g. the include
+// directories and defines of its targets
+const qint64 StringSlack = 256;
+const qint64 ByteSlack = 64 * 1024;
+
+QByteArray exceeds(qint64 value, qint64 bound)
+{
+    return QByteArray::number(value) + " exceeds " + QByteArray::number(bound);
+}
+
+} // anon
+
+class tst_Footprint : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void items_data();
+    void items();
+
+private:
+    QTemporaryDir m_directory;
+    QString m_projectFile;
+};
+
+void tst_Footprint::initTestCase()
+{
+    QVERIFY(m_directory.isValid());
+    m_projectFile = VsTestProjects::writeProject(m_directory.path(), QLatin1String("footprint"), ItemCount);
+    QVERIFY(!m_projectFile.isEmpty());
+}
+
+void tst_Footprint::items_data()
+{
+    QTest::addColumn<VsProjectData::ParserType>("parser");
+
+    QTest::newRow("dom") << VsProjectData::DomParser;
+    QTest::newRow("stream") << VsProjectData::StreamParser;
+    QTest::newRow("tokenizer") << VsProjectData::TokenizerParser;
+}
+
+// A loaded project retains each item once, as a pooled string, and nothing of
+// the document it was read from. Another instance of it adds next to nothing.
+void tst_Footprint::items()
+{
+    QFETCH(VsProjectData::ParserType, parser);
+    const auto projectFile = Utils::FileName::fromString(m_projectFile);
+
+    const auto before = VsStringPool::statistics();
+    QScopedPointer<VsProjectData> data(VsProjectData::load(projectFile, QString(), parser));
+    QVERIFY(!data.isNull());
+    QCOMPARE(data->targets().size(), VsTestProjects::configurations().size());
+    const auto loaded = VsStringPool::statistics();
+
+    const auto files = data->files();
+    QCOMPARE(files.size(), ItemCount);
+    QCOMPARE(files.toSet().size(), ItemCount);
+
+    qint64 pathBytes = 0;
+    foreach (const QString& file, files) {
+        pathBytes += file.size() * qint64(sizeof(QChar));
+    }
+
+    const auto strings = loaded.uniqueStrings - before.uniqueStrings;
+    QVERIFY2(strings <= ItemCount + StringSlack, exceeds(strings, ItemCount + StringSlack).constData());
+    const auto bytes = loaded.uniqueBytes - before.uniqueBytes;
+    QVERIFY2(bytes <= pathBytes + ByteSlack, exceeds(bytes, pathBytes + ByteSlack).constData());
+
+    QScopedPointer<VsProjectData> other(VsProjectData::load(projectFile, QString(), parser));
+    QVERIFY(!other.isNull());
+    QCOMPARE(other->targets().size(), VsTestProjects::configurations().size());
+    const auto shared = VsStringPool::statistics();
+
+    const auto otherStrings = shared.uniqueStrings - loaded.uniqueStrings;
+    QVERIFY2(otherStrings <= StringSlack, exceeds(otherStrings, StringSlack).constData());
+    const auto otherBytes = shared.uniqueBytes - loaded.uniqueBytes;
+    QVERIFY2(otherBytes <= ByteSlack, exceeds(otherBytes, ByteSlack).constData());
+
+    // Checked last, interning counts as a request of its own
+    const auto otherFiles = other->files();
+    QCOMPARE(otherFiles.size(), ItemCount);
+    for (auto i = 0; i < ItemCount; ++i) {
+        QCOMPARE(VsStringPool::intern(files.at(i)).constData(), files.at(i).constData());
+        QCOMPARE(otherFiles.at(i).constData(), files.at(i).constData());
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_Footprint)
+
+#include "tst_footprint.moc"
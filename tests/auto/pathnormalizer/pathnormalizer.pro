@@ -0,0 +1,8 @@
+include(../../vstest.pri)
+
+HEADERS += \
+    $$VSPROJECTMANAGER_DIR/vspathnormalizer.h
+
+SOURCES += \
+    $$VSPROJECTMANAGER_DIR/vspathnormalizer.cpp \
+    tst_pathnormalizer.cpp
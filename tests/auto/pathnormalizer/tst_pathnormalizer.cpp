@@ -0,0 +1,224 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#include "vspathnormalizer.h"
+
+#include <QDir>
+#include <QtTest>
+
+#include <random>
+
+using namespace VsProjectManager::Internal;
+
+namespace {
+
+const int CorpusSize = 200000;
+
+// Random paths built from the segments and roots which need folding, mostly
+// relative ones if roots is empty
+QStringList corpus(const QStringList& roots, QChar separator)
+{
+    const QStringList segments = {
+        QStringLiteral("a"),
+        QStringLiteral("bc"),
+        QStringLiteral("."),
+        QStringLiteral(".."),
+        QString(),
+        QStringLiteral("..."),
+        QStringLiteral(".x"),
+        QStringLiteral("x."),
+        QStringLiteral("..a"),
+        QStringLiteral("C:"),
+        QStringLiteral(":"),
+        QStringLiteral("Program Files (x86)"),
+        QStringLiteral("include"),
+        QString::fromUtf8("\xc3\xa4rger")
+    };
+
+    std::mt19937 random(19);
+    auto pick = [&random](const QStringList& list) {
+        return list.at(std::uniform_int_distribution<int>(0, list.size() - 1)(random));
+    };
+
+    QStringList result;
+    result.reserve(CorpusSize);
+    for (auto i = 0; i < CorpusSize; ++i) {
+        auto path = roots.isEmpty() ? QString() : pick(roots);
+        const auto count = std::uniform_int_distribution<int>(0, 8)(random);
+        for (auto j = 0; j < count; ++j) {
+            if (j) {
+                path += separator;
+            }
+            path += pick(segments);
+        }
+        if (std::uniform_int_distribution<int>(0, 3)(random) == 0) {
+            path += separator;
+        }
+        result << path;
+    }
+    return result;
+}
+
+QStringList roots()
+{
+    return {
+        QString(),
+        QStringLiteral("/"),
+        QStringLiteral("//"),
+        QStringLiteral("///"),
+        QStringLiteral("C:"),
+        QStringLiteral("c:/"),
+        QStringLiteral("C://"),
+        QStringLiteral("//server/"),
+        QStringLiteral("//server"),
+        QStringLiteral("//c:/"),
+        QStringLiteral("1:/"),
+        QStringLiteral("/:"),
+        QStringLiteral("."),
+        QStringLiteral(".."),
+        QStringLiteral(":/")
+    };
+}
+
+QByteArray differs(const QString& path, const QString& actual, const QString& expected)
+{
+    return QString::fromLatin1("\"%1\": \"%2\" instead of \"%3\"").arg(path, actual, expected).toUtf8();
+}
+
+} // anon
+
+// VsPathNormalizer folds paths the way QDir::cleanPath() does on Windows, the
+// results are compared over a large corpus of random paths
+class tst_PathNormalizer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanPath_data();
+    void cleanPath();
+    void cleanPathCorpus();
+    void backslashCorpus();
+    void absoluteFilePathCorpus();
+};
+
+void tst_PathNormalizer::initTestCase()
+{
+#ifndef Q_OS_WIN
+    QSKIP("QDir::cleanPath() only knows drives and UNC paths on Windows");
+#endif
+}
+
+void tst_PathNormalizer::cleanPath_data()
+{
+    QTest::addColumn<QString>("path");
+
+    QTest::newRow("clean") << QStringLiteral("C:/work/project/main.cpp");
+    QTest::newRow("double slash") << QStringLiteral("/Users/sam/troll/qt4.0//..");
+    QTest::newRow("root") << QStringLiteral("/");
+    QTest::newRow("up to root") << QStringLiteral("/path/..");
+    QTest::newRow("above root") << QStringLiteral("/..");
+    QTest::newRow("above drive") << QStringLiteral("d:/a/bc/def/../../../..");
+    QTest::newRow("drive root") << QStringLiteral("d:/a/bc/def/../../..");
+    QTest::newRow("drive relative") << QStringLiteral("C:foo/../bar");
+    QTest::newRow("current") << QStringLiteral(".//file1.txt");
+    QTest::newRow("two slashes") << QStringLiteral("//");
+    QTest::newRow("three slashes") << QStringLiteral("///");
+    QTest::newRow("unc") << QStringLiteral("//foo//bar");
+    QTest::newRow("unc server") << QStringLiteral("//server/");
+    QTest::newRow("unc above server") << QStringLiteral("//server/../share");
+    QTest::newRow("drive and unc") << QStringLiteral("//c:/foo");
+    QTest::newRow("trailing slash") << QStringLiteral("ab/a/");
+    QTest::newRow("drive slashes") << QStringLiteral("c://");
+    QTest::newRow("drive look-alike") << QStringLiteral("a/../C:/");
+    QTest::newRow("folded to nothing") << QStringLiteral("foo/../");
+    QTest::newRow("parents") << QStringLiteral("../a/../..");
+    QTest::newRow("resource") << QStringLiteral("://prefix/..//prefix/foo.bar");
+}
+
+void tst_PathNormalizer::cleanPath()
+{
+    QFETCH(QString, path);
+
+    QCOMPARE(VsPathNormalizer::cleanPath(path), QDir::cleanPath(path));
+}
+
+void tst_PathNormalizer::cleanPathCorpus()
+{
+    foreach (const QString& path, corpus(roots(), QLatin1Char('/'))) {
+        const auto actual = VsPathNormalizer::cleanPath(path);
+        const auto expected = QDir::cleanPath(path);
+        QVERIFY2(actual == expected, differs(path, actual, expected).constData());
+    }
+}
+
+// Covers the SSE2 conversion at every length and alignment of the backslashes
+void tst_PathNormalizer::backslashCorpus()
+{
+    QStringList nativeRoots;
+    foreach (const QString& root, roots()) {
+        nativeRoots << QDir::toNativeSeparators(root);
+    }
+
+    foreach (const QString& path, corpus(nativeRoots, QLatin1Char('\\'))) {
+        auto slashes = path;
+        VsPathNormalizer::toForwardSlashes(slashes);
+        QVERIFY2(slashes == QDir::fromNativeSeparators(path), differs(path, slashes, QDir::fromNativeSeparators(path)).constData());
+
+        const auto actual = VsPathNormalizer::cleanPath(slashes);
+        const auto expected = QDir::cleanPath(path);
+        QVERIFY2(actual == expected, differs(path, actual, expected).constData());
+    }
+}
+
+// Twice, the second round is answered from the memo
+void tst_PathNormalizer::absoluteFilePathCorpus()
+{
+    const QStringList baseDirectories = {
+        QStringLiteral("C:/work/project"),
+        QStringLiteral("C:/work/project/"),
+        QStringLiteral("//server/share/project")
+    };
+    const auto paths = corpus(QStringList(), QLatin1Char('\\'));
+
+    for (auto round = 0; round < 2; ++round) {
+        foreach (const QString& baseDirectory, baseDirectories) {
+            foreach (const QString& path, paths) {
+                if (QDir::isAbsolutePath(path)) {
+                    continue;
+                }
+
+                const auto actual = VsPathNormalizer::absoluteFilePath(baseDirectory, path);
+                const auto expected = QDir::cleanPath(baseDirectory + QLatin1Char('/') + QDir::fromNativeSeparators(path));
+                QVERIFY2(actual == expected, differs(path, actual, expected).constData());
+            }
+        }
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_PathNormalizer)
+
+#include "tst_pathnormalizer.moc"
@@ -0,0 +1,230 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#include "vstestprojects.h"
+#include "vsxmltokenizer.h"
+
+#include <QTemporaryDir>
+#include <QTextCodec>
+#include <QtTest>
+
+using namespace VsProjectManager::Internal;
+
+namespace {
+
+// Characters which end a run of ASCII, on either side of the bounds the
+// narrowing checks. 0x4100 is "A" with its bytes swapped.
+const ushort Interruptions[] = {
+    0x007F, 0x0080, 0x00E9, 0x00FF, 0x0100, 0x20AC, 0x4100, 0xFF41, 0xFFFD
+};
+// Around the eight code units narrowed at a time
+const int RunLengths[] = { 0, 1, 7, 8, 9, 15, 16, 17, 24, 31, 32, 33 };
+const uint SurrogatePair = 0x1F600;
+
+QString asciiRun(int length, int offset)
+{
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789_.";
+    QString run;
+    run.reserve(length);
+    for (auto i = 0; i < length; ++i) {
+        run += QLatin1Char(alphabet[(offset + i) % (sizeof(alphabet) - 1)]);
+    }
+    return run;
+}
+
+QString surrogatePair()
+{
+    return QString() + QChar(QChar::highSurrogate(SurrogatePair)) + QChar(QChar::lowSurrogate(SurrogatePair));
+}
+
+// Runs of all lengths, each interrupted by every character. The text is both
+// an attribute and the content of an element, which varies its alignment.
+QStringList texts()
+{
+    QStringList result;
+    for (const auto interruption : Interruptions) {
+        for (const auto length : RunLengths) {
+            result << asciiRun(length, length) + QChar(interruption) + asciiRun(length + 3, length);
+        }
+    }
+    for (const auto length : RunLengths) {
+        result << asciiRun(length, 0) + surrogatePair() + asciiRun(length, 1) + surrogatePair();
+    }
+    result << surrogatePair() << QString(QChar(Interruptions[0]));
+    return result;
+}
+
+QString document(const QStringList& texts)
+{
+    auto result = QString::fromLatin1("<?xml version=\"1.0\" encoding=\"utf-16\"?>\r\n<Project>\r\n");
+    foreach (const QString& text, texts) {
+        result += QLatin1String("  <Item Include=\"") + text + QLatin1String("\">") + text + QLatin1String("</Item>\r\n");
+    }
+    result += QLatin1String("</Project>\r\n");
+    return result;
+}
+
+QByteArray utf16(const QString& text, bool bigEndian, bool byteOrderMark)
+{
+    QByteArray result;
+    result.reserve(2 * text.size() + 2);
+    const auto append = [&result, bigEndian](ushort unit) {
+        const auto high = static_cast<char>(unit >> 8);
+        const auto low = static_cast<char>(unit & 0xFF);
+        result += bigEndian ? high : low;
+        result += bigEndian ? low : high;
+    };
+
+    if (byteOrderMark) {
+        append(0xFEFF);
+    }
+    for (const auto c : text) {
+        append(c.unicode());
+    }
+    return result;
+}
+
+} // anon
+
+class tst_XmlTokenizer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void utf16_data();
+    void utf16();
+    void unpairedSurrogates();
+    void declaredEncoding();
+
+private:
+    QString writeFile(const QString& name, const QByteArray& content);
+    void verifyItems(const QString& filePath, const QString& document, const QStringList& items);
+
+    QTemporaryDir m_directory;
+};
+
+void tst_XmlTokenizer::initTestCase()
+{
+    QVERIFY(m_directory.isValid());
+}
+
+QString tst_XmlTokenizer::writeFile(const QString& name, const QByteArray& content)
+{
+    return VsTestProjects::writeFile(m_directory.path() + QLatin1Char('/') + name + QLatin1String(".xml"), content);
+}
+
+// The whole document and each item as read by the tokenizer
+void tst_XmlTokenizer::verifyItems(const QString& filePath, const QString& document, const QStringList& items)
+{
+    QVERIFY(!filePath.isEmpty());
+    VsXmlTokenizer tokenizer(filePath);
+    QVERIFY2(tokenizer.isOpen(), qPrintable(tokenizer.errorString()));
+    QCOMPARE(tokenizer.document(), document);
+
+    QVERIFY(tokenizer.readNextStartElement());
+    QVERIFY(tokenizer.name() == QLatin1String("Project"));
+    auto count = 0;
+    while (tokenizer.readNextStartElement()) {
+        QVERIFY(count < items.size());
+        QVERIFY(tokenizer.name() == QLatin1String("Item"));
+        QCOMPARE(tokenizer.attributes().value(QLatin1String("Include")).toString(), items.at(count));
+        QCOMPARE(tokenizer.readElementText(), items.at(count));
+        ++count;
+    }
+    QVERIFY2(!tokenizer.hasError(), qPrintable(tokenizer.errorString()));
+    QCOMPARE(count, items.size());
+}
+
+void tst_XmlTokenizer::utf16_data()
+{
+    QTest::addColumn<bool>("bigEndian");
+    QTest::addColumn<bool>("byteOrderMark");
+    QTest::addColumn<bool>("oddByte");
+
+    QTest::newRow("le") << false << false << false;
+    QTest::newRow("le bom") << false << true << false;
+    QTest::newRow("le odd byte") << false << true << true;
+    QTest::newRow("be") << true << false << false;
+    QTest::newRow("be bom") << true << true << false;
+    QTest::newRow("be odd byte") << true << true << true;
+}
+
+// A trailing odd byte is no code unit and dropped
+void tst_XmlTokenizer::utf16()
+{
+    QFETCH(bool, bigEndian);
+    QFETCH(bool, byteOrderMark);
+    QFETCH(bool, oddByte);
+
+    const auto items = texts();
+    const auto source = document(items);
+    auto content = utf16(source, bigEndian, byteOrderMark);
+    if (oddByte) {
+        content += '\n';
+    }
+
+    verifyItems(writeFile(QString::fromLatin1(QTest::currentDataTag()).replace(QLatin1Char(' '), QLatin1Char('_')), content),
+                source, items);
+}
+
+// Halves of surrogate pairs on their own become replacement characters
+void tst_XmlTokenizer::unpairedSurrogates()
+{
+    const auto high = QChar(QChar::highSurrogate(SurrogatePair));
+    const auto low = QChar(QChar::lowSurrogate(SurrogatePair));
+    const auto replacement = QChar(QChar::ReplacementCharacter);
+
+    QStringList items;
+    QStringList expected;
+    foreach (const auto length, QList<int>() << 0 << 7 << 8 << 9 << 16) {
+        const auto run = asciiRun(length, length);
+        items << run + high + run << run + low + run << run + low + high + run;
+        expected << run + replacement + run << run + replacement + run << run + replacement + replacement + run;
+    }
+
+    const auto filePath = writeFile(QLatin1String("unpaired"), utf16(document(items), false, true));
+    verifyItems(filePath, document(expected), expected);
+}
+
+// Files declaring a legacy encoding are decoded if they aren't just ASCII
+void tst_XmlTokenizer::declaredEncoding()
+{
+    const QStringList items = {
+        QString::fromUtf8("Gr\xc3\xbc\xc3\x9f" "e"),
+        QString::fromUtf8("\xe2\x82\xac 100"),
+        asciiRun(40, 0) + QString::fromUtf8("\xc3\xa9")
+    };
+    const auto source = document(items).replace(QLatin1String("utf-16"), QLatin1String("Windows-1252"));
+
+    const auto codec = QTextCodec::codecForName("Windows-1252");
+    QVERIFY(codec);
+    verifyItems(writeFile(QLatin1String("windows1252"), codec->fromUnicode(source)), source, items);
+}
+
+QTEST_GUILESS_MAIN(tst_XmlTokenizer)
+
+#include "tst_xmltokenizer.moc"
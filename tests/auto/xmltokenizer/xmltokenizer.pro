@@ -0,0 +1,9 @@
+include(../../vstest.pri)
+include(../../shared/shared.pri)
+
+HEADERS += \
+    $$VSPROJECTMANAGER_DIR/vsxmltokenizer.h
+
+SOURCES += \
+    $$VSPROJECTMANAGER_DIR/vsxmltokenizer.cpp \
+    tst_xmltokenizer.cpp
@@ -0,0 +1,113 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#include "vsprojectdata.h"
+#include "vstestprojects.h"
+
+#include <QScopedPointer>
+#include <QTemporaryDir>
+#include <QtTest>
+
+using namespace VsProjectManager::Internal;
+
+// Reading the configuration names of a project, once by scanning it and once
+// by loading it the way VsBuildConfigurationFactory used to.
+class tst_ScanConfigurations : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void scan_data();
+    void scan();
+    void load_data();
+    void load();
+
+private:
+    void addProjects();
+
+    QTemporaryDir m_directory;
+    QStringList m_projectNames;
+    QStringList m_projectFiles;
+};
+
+void tst_ScanConfigurations::initTestCase()
+{
+    QVERIFY(m_directory.isValid());
+
+    foreach (auto itemCount, QList<int>() << 100 << 1000 << 10000) {
+        const auto name = QString::fromLatin1("items%1").arg(itemCount);
+        const auto projectFile = VsTestProjects::writeProject(m_directory.path(), name, itemCount);
+        QVERIFY(!projectFile.isEmpty());
+        m_projectNames << name;
+        m_projectFiles << projectFile;
+    }
+}
+
+void tst_ScanConfigurations::addProjects()
+{
+    QTest::addColumn<QString>("projectFile");
+
+    for (auto i = 0; i < m_projectFiles.size(); ++i) {
+        QTest::newRow(m_projectNames.at(i).toLatin1().constData()) << m_projectFiles.at(i);
+    }
+}
+
+void tst_ScanConfigurations::scan_data()
+{
+    addProjects();
+}
+
+void tst_ScanConfigurations::scan()
+{
+    QFETCH(QString, projectFile);
+    const auto filePath = Utils::FileName::fromString(projectFile);
+
+    QBENCHMARK {
+        QCOMPARE(VsProjectData::scanConfigurations(filePath), VsTestProjects::configurations());
+    }
+}
+
+void tst_ScanConfigurations::load_data()
+{
+    addProjects();
+}
+
+void tst_ScanConfigurations::load()
+{
+    QFETCH(QString, projectFile);
+    const auto filePath = Utils::FileName::fromString(projectFile);
+
+    QBENCHMARK {
+        QScopedPointer<VsProjectData> data(VsProjectData::load(filePath));
+        QVERIFY(!data.isNull());
+        QCOMPARE(data->configurations(), VsTestProjects::configurations());
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_ScanConfigurations)
+
+#include "tst_scanconfigurations.moc"
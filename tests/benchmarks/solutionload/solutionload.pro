@@ -0,0 +1,6 @@
+include(../../vsmodel.pri)
+
+CONFIG += benchmark
+
+SOURCES += \
+    tst_solutionload.cpp
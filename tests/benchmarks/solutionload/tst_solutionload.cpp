@@ -0,0 +1,106 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#include "vsprojectdata.h"
+#include "vssolutiondata.h"
+#include "vstestprojects.h"
+
+#include <QScopedPointer>
+#include <QTemporaryDir>
+#include <QtTest>
+
+using namespace VsProjectManager::Internal;
+
+namespace {
+
+const char LoadThreadsVariable[] = "QTC_VSPROJECTMANAGER_LOAD_THREADS";
+const int ProjectCount = 64;
+const int ItemCount = 500;
+
+} // anon
+
+// Loads a solution of ProjectCount projects with 1 to 32 loader threads. The
+// projects are loaded again in every iteration, the memos of the paths and
+// property sheets stay warm.
+class tst_SolutionLoad : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void load_data();
+    void load();
+
+private:
+    QTemporaryDir m_directory;
+    QString m_solutionFile;
+    QByteArray m_loadThreads;
+};
+
+void tst_SolutionLoad::initTestCase()
+{
+    QVERIFY(m_directory.isValid());
+    m_solutionFile = VsTestProjects::writeSolution(m_directory.path(), QLatin1String("scaling"), ProjectCount, ItemCount);
+    QVERIFY(!m_solutionFile.isEmpty());
+    m_loadThreads = qgetenv(LoadThreadsVariable);
+}
+
+void tst_SolutionLoad::cleanupTestCase()
+{
+    if (m_loadThreads.isEmpty()) {
+        qunsetenv(LoadThreadsVariable);
+    } else {
+        qputenv(LoadThreadsVariable, m_loadThreads);
+    }
+}
+
+void tst_SolutionLoad::load_data()
+{
+    QTest::addColumn<int>("threads");
+
+    for (auto threads = 1; threads <= 32; threads *= 2) {
+        QTest::newRow(QByteArray::number(threads).constData()) << threads;
+    }
+}
+
+void tst_SolutionLoad::load()
+{
+    QFETCH(int, threads);
+    qputenv(LoadThreadsVariable, QByteArray::number(threads));
+    QCOMPARE(VsSolutionData::loaderThreadCount(), threads);
+
+    const auto solutionFile = Utils::FileName::fromString(m_solutionFile);
+    QBENCHMARK {
+        QScopedPointer<VsProjectData> data(VsProjectData::load(solutionFile));
+        QVERIFY(!data.isNull());
+        QCOMPARE(data->subProjects().size(), ProjectCount);
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_SolutionLoad)
+
+#include "tst_solutionload.moc"
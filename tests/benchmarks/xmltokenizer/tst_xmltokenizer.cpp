@@ -0,0 +1,111 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#include "vstestprojects.h"
+#include "vsxmltokenizer.h"
+
+#include <QTemporaryDir>
+#include <QTextCodec>
+#include <QtTest>
+
+using namespace VsProjectManager::Internal;
+
+namespace {
+
+const int ItemCount = 10000;
+
+} // anon
+
+// Tokenizes the same project saved as UTF-8, UTF-16LE and Windows-1252, the
+// latter two are decoded to UTF-8 up front. The project is ASCII but for a
+// comment, like most MSBuild files.
+class tst_XmlTokenizer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void tokenize_data();
+    void tokenize();
+
+private:
+    QTemporaryDir m_directory;
+};
+
+void tst_XmlTokenizer::initTestCase()
+{
+    QVERIFY(m_directory.isValid());
+}
+
+void tst_XmlTokenizer::tokenize_data()
+{
+    QTest::addColumn<QString>("filePath");
+
+    const auto declaration = QString::fromLatin1("encoding=\"utf-8\"");
+    auto source = QString::fromUtf8(VsTestProjects::project(ItemCount));
+    source.insert(source.indexOf(QLatin1String("<Project")), QString::fromUtf8("<!-- Ge\xc3\xa4ndert f\xc3\xbcr Gr\xc3\xb6\xc3\x9f" "en -->\r\n"));
+
+    const auto directory = m_directory.path() + QLatin1Char('/');
+    QTest::newRow("utf-8") << VsTestProjects::writeFile(directory + QLatin1String("utf8.vcxproj"), source.toUtf8());
+
+    auto utf16 = source;
+    utf16.replace(declaration, QLatin1String("encoding=\"utf-16\""));
+    QByteArray content("\xFF\xFE");
+    for (const auto c : utf16) {
+        content += static_cast<char>(c.unicode() & 0xFF);
+        content += static_cast<char>(c.unicode() >> 8);
+    }
+    QTest::newRow("utf-16le") << VsTestProjects::writeFile(directory + QLatin1String("utf16le.vcxproj"), content);
+
+    auto windows1252 = source;
+    windows1252.replace(declaration, QLatin1String("encoding=\"Windows-1252\""));
+    content = QTextCodec::codecForName("Windows-1252")->fromUnicode(windows1252);
+    QTest::newRow("windows-1252") << VsTestProjects::writeFile(directory + QLatin1String("windows1252.vcxproj"), content);
+}
+
+void tst_XmlTokenizer::tokenize()
+{
+    QFETCH(QString, filePath);
+    QVERIFY(!filePath.isEmpty());
+
+    QBENCHMARK {
+        VsXmlTokenizer tokenizer(filePath);
+        QVERIFY(tokenizer.isOpen());
+        auto items = 0;
+        for (auto token = tokenizer.readNext(); token != VsXmlTokenizer::EndDocument; token = tokenizer.readNext()) {
+            QVERIFY2(token != VsXmlTokenizer::Invalid, qPrintable(tokenizer.errorString()));
+            if (token == VsXmlTokenizer::StartElement && tokenizer.name() == QLatin1String("ClCompile")
+                    && !tokenizer.attributes().isEmpty()) {
+                ++items;
+            }
+        }
+        QCOMPARE(items, ItemCount);
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_XmlTokenizer)
+
+#include "tst_xmltokenizer.moc"
@@ -0,0 +1,11 @@
+include(../../vstest.pri)
+include(../../shared/shared.pri)
+
+CONFIG += benchmark
+
+HEADERS += \
+    $$VSPROJECTMANAGER_DIR/vsxmltokenizer.h
+
+SOURCES += \
+    $$VSPROJECTMANAGER_DIR/vsxmltokenizer.cpp \
+    tst_xmltokenizer.cpp
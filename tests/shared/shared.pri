@@ -0,0 +1,8 @@
+# Synthetic projects
+INCLUDEPATH += $$PWD
+
+HEADERS += \
+    $$PWD/vstestprojects.h
+
+SOURCES += \
+    $$PWD/vstestprojects.cpp
@@ -0,0 +1,164 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#include "vstestprojects.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QUuid>
+
+namespace VsProjectManager {
+namespace Internal {
+
+namespace {
+
+const int ItemsPerDirectory = 100;
+
+QByteArray guid(int index)
+{
+    return QUuid(0x56535450, 0, static_cast<ushort>(index), 0, 0, 0, 0, 0, 0, 0, 0).toString().toUpper().toLatin1();
+}
+
+} // anon
+
+QStringList VsTestProjects::configurations()
+{
+    return QStringList()
+            << QStringLiteral("Debug|Win32")
+            << QStringLiteral("Release|Win32")
+            << QStringLiteral("Debug|x64")
+            << QStringLiteral("Release|x64");
+}
+
+QString VsTestProjects::itemPath(int item)
+{
+    return QString::fromLatin1("src\\dir%1\\file%2.cpp").arg(item / ItemsPerDirectory).arg(item);
+}
+
+QByteArray VsTestProjects::project(int itemCount)
+{
+    QByteArray result;
+    result += "<?xml version=\"1.0\" encoding=\"utf-8\"?>\r\n"
+              "<Project DefaultTargets=\"Build\" ToolsVersion=\"14.0\" xmlns=\"http://schemas.microsoft.com/developer/msbuild/2003\">\r\n"
+              "  <ItemGroup Label=\"ProjectConfigurations\">\r\n";
+    foreach (const QString& configuration, configurations()) {
+        result += "    <ProjectConfiguration Include=\"" + configuration.toLatin1() + "\" />\r\n";
+    }
+    result += "  </ItemGroup>\r\n";
+
+    foreach (const QString& configuration, configurations()) {
+        const auto condition = "Condition=\"'$(Configuration)|$(Platform)'=='" + configuration.toLatin1() + "'\"";
+        const auto debug = configuration.startsWith(QLatin1String("Debug"));
+        result += "  <PropertyGroup " + condition + " Label=\"Configuration\">\r\n"
+                  "    <ConfigurationType>Application</ConfigurationType>\r\n"
+                  "    <CharacterSet>Unicode</CharacterSet>\r\n"
+                  "  </PropertyGroup>\r\n"
+                  "  <ItemDefinitionGroup " + condition + ">\r\n"
+                  "    <ClCompile>\r\n"
+                  "      <PreprocessorDefinitions>" + (debug ? "_DEBUG" : "NDEBUG") + ";_CONSOLE;%(PreprocessorDefinitions)</PreprocessorDefinitions>\r\n"
+                  "      <AdditionalIncludeDirectories>$(ProjectDir)include;$(SolutionDir)common;%(AdditionalIncludeDirectories)</AdditionalIncludeDirectories>\r\n"
+                  "      <RuntimeLibrary>" + (debug ? "MultiThreadedDebugDLL" : "MultiThreadedDLL") + "</RuntimeLibrary>\r\n"
+                  "    </ClCompile>\r\n"
+                  "  </ItemDefinitionGroup>\r\n";
+    }
+
+    result += "  <ItemGroup>\r\n";
+    for (auto i = 0; i < itemCount; ++i) {
+        result += "    <ClCompile Include=\"" + itemPath(i).toLatin1() + "\" />\r\n";
+    }
+    result += "  </ItemGroup>\r\n"
+              "</Project>\r\n";
+    return result;
+}
+
+QByteArray VsTestProjects::solution(const QStringList& projectFiles)
+{
+    QByteArray result;
+    result += "\xEF\xBB\xBF\r\n"
+              "Microsoft Visual Studio Solution File, Format Version 12.00\r\n"
+              "VisualStudioVersion = 14.0.25420.1\r\n";
+    for (auto i = 0; i < projectFiles.size(); ++i) {
+        const auto name = QFileInfo(projectFiles.at(i)).completeBaseName().toUtf8();
+        result += "Project(\"{8BC9CEB8-8B4A-11D0-8D11-00A0C91BC942}\") = \"" + name + "\", \""
+                + QDir::toNativeSeparators(projectFiles.at(i)).toUtf8() + "\", \"" + guid(i) + "\"\r\n"
+                  "EndProject\r\n";
+    }
+
+    result += "Global\r\n"
+              "\tGlobalSection(SolutionConfigurationPlatforms) = preSolution\r\n";
+    foreach (const QString& configuration, configurations()) {
+        result += "\t\t" + configuration.toLatin1() + " = " + configuration.toLatin1() + "\r\n";
+    }
+    result += "\tEndGlobalSection\r\n"
+              "\tGlobalSection(ProjectConfigurationPlatforms) = postSolution\r\n";
+    for (auto i = 0; i < projectFiles.size(); ++i) {
+        foreach (const QString& configuration, configurations()) {
+            const auto key = "\t\t" + guid(i) + "." + configuration.toLatin1();
+            result += key + ".ActiveCfg = " + configuration.toLatin1() + "\r\n";
+            result += key + ".Build.0 = " + configuration.toLatin1() + "\r\n";
+        }
+    }
+    result += "\tEndGlobalSection\r\n"
+              "EndGlobal\r\n";
+    return result;
+}
+
+QString VsTestProjects::writeFile(const QString& filePath, const QByteArray& content)
+{
+    if (!QDir().mkpath(QFileInfo(filePath).absolutePath())) {
+        return QString();
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(content) != content.size()) {
+        return QString();
+    }
+    return filePath;
+}
+
+QString VsTestProjects::writeProject(const QString& directory, const QString& name, int itemCount)
+{
+    return writeFile(directory + QLatin1Char('/') + name + QLatin1String(".vcxproj"), project(itemCount));
+}
+
+QString VsTestProjects::writeSolution(const QString& directory, const QString& name, int projectCount, int itemCount)
+{
+    QStringList projectFiles;
+    for (auto i = 0; i < projectCount; ++i) {
+        const auto projectName = QString::fromLatin1("project%1").arg(i);
+        const auto projectFile = writeProject(directory + QLatin1Char('/') + projectName, projectName, itemCount);
+        if (projectFile.isEmpty()) {
+            return QString();
+        }
+        projectFiles << projectName + QLatin1Char('/') + projectName + QLatin1String(".vcxproj");
+    }
+
+    return writeFile(directory + QLatin1Char('/') + name + QLatin1String(".sln"), solution(projectFiles));
+}
+
+} // namespace Internal
+} // namespace VsProjectManager
@@ -0,0 +1,58 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+namespace VsProjectManager {
+namespace Internal {
+
+// Synthetic project files for the tests and benchmarks. The projects have
+// Debug and Release configurations for Win32 and x64, itemCount ClCompile
+// items spread over directories of 100 and an item definition group per
+// configuration.
+class VsTestProjects
+{
+public:
+    static QStringList configurations();
+    static QByteArray project(int itemCount);
+    static QByteArray solution(const QStringList& projectFiles);
+
+    // Relative path of an item as listed in the project, with backslashes
+    static QString itemPath(int item);
+
+    // Return the path of the written file, an empty string if it couldn't be written
+    static QString writeFile(const QString& filePath, const QByteArray& content);
+    static QString writeProject(const QString& directory, const QString& name, int itemCount);
+    // Writes projectCount projects, each in a directory of its own, and the solution referring to them
+    static QString writeSolution(const QString& directory, const QString& name, int projectCount, int itemCount);
+};
+
+} // namespace Internal
+} // namespace VsProjectManager
@@ -0,0 +1,35 @@
+# The project model of the plugin, everything but the Qt Creator integration
+
+include(vstest.pri)
+
+HEADERS += \
+    $$VSPROJECTMANAGER_DIR/vsprojectdata.h \
+    $$VSPROJECTMANAGER_DIR/vsprojectdatacache.h \
+    $$VSPROJECTMANAGER_DIR/vsprojectdataregistry.h \
+    $$VSPROJECTMANAGER_DIR/vsxmltokenizer.h \
+    $$VSPROJECTMANAGER_DIR/vsmacroexpander.h \
+    $$VSPROJECTMANAGER_DIR/vspropertyfunctions.h \
+    $$VSPROJECTMANAGER_DIR/vsconditionevaluator.h \
+    $$VSPROJECTMANAGER_DIR/vspropertysheetcache.h \
+    $$VSPROJECTMANAGER_DIR/vsstringpool.h \
+    $$VSPROJECTMANAGER_DIR/vsdefineset.h \
+    $$VSPROJECTMANAGER_DIR/vssolutiondata.h \
+    $$VSPROJECTMANAGER_DIR/vspathnormalizer.h \
+    $$VSPROJECTMANAGER_DIR/vswildcardexpander.h
+
+SOURCES += \
+    $$VSPROJECTMANAGER_DIR/vsprojectdata.cpp \
+    $$VSPROJECTMANAGER_DIR/vsprojectdatacache.cpp \
+    $$VSPROJECTMANAGER_DIR/vsprojectdataregistry.cpp \
+    $$VSPROJECTMANAGER_DIR/vsxmltokenizer.cpp \
+    $$VSPROJECTMANAGER_DIR/vsmacroexpander.cpp \
+    $$VSPROJECTMANAGER_DIR/vspropertyfunctions.cpp \
+    $$VSPROJECTMANAGER_DIR/vsconditionevaluator.cpp \
+    $$VSPROJECTMANAGER_DIR/vspropertysheetcache.cpp \
+    $$VSPROJECTMANAGER_DIR/vsstringpool.cpp \
+    $$VSPROJECTMANAGER_DIR/vsdefineset.cpp \
+    $$VSPROJECTMANAGER_DIR/vssolutiondata.cpp \
+    $$VSPROJECTMANAGER_DIR/vspathnormalizer.cpp \
+    $$VSPROJECTMANAGER_DIR/vswildcardexpander.cpp
+
+include(shared/shared.pri)
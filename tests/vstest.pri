@@ -0,0 +1,14 @@
+# Common setup of the tests and benchmarks. They are built inside the Qt Creator
+# source tree like the plugin itself, see ../vsprojectmanager.pro.
+
+QTC_LIB_DEPENDS += \
+    utils
+QTC_PLUGIN_DEPENDS += \
+    projectexplorer
+
+include(../../../../tests/auto/qttest.pri)
+
+QT += xml concurrent
+
+VSPROJECTMANAGER_DIR = $$PWD/..
+INCLUDEPATH += $$VSPROJECTMANAGER_DIR
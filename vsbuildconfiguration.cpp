@@ -26,8 +26,10 @@
 
 #include "vsbuildconfiguration.h"
 #include "devenvstep.h"
+#include "vssolutionbuildstep.h"
 #include "vsproject.h"
 #include "vsprojectdata.h"
+#include "vsprojectdataregistry.h"
 #include "vsprojectconstants.h"
 
 #include <coreplugin/icore.h>
@@ -206,8 +208,10 @@ int VsBuildConfigurationFactory::priority(const ProjectExplorer::Kit *k, const Q
 QList<ProjectExplorer::BuildInfo *> VsBuildConfigurationFactory::availableSetups(const ProjectExplorer::Kit *k, const QString &projectPath) const
 {
     QList<ProjectExplorer::BuildInfo *> result;
-    QScopedPointer<VsProjectData> data(VsProjectData::load(Utils::FileName::fromString(projectPath)));
-    QTC_ASSERT(!data.isNull(), return result);
+    // The kit setup page only needs the names, an open project knows them already
+    const Utils::FileName projectFile = Utils::FileName::fromString(projectPath);
+    const VsProjectDataPtr data = VsProjectDataRegistry::find(projectFile);
+    const QStringList configurations = data ? data->configurations() : VsProjectData::scanConfigurations(projectFile);
 
 //    foreach (const VsBuildTarget& target, data->targets()) {
 //        auto buildInfo = new VsBuildInfo(this);
@@ -220,7 +224,7 @@ QList<ProjectExplorer::BuildInfo *> VsBuildConfigurationFactory::availableSetups
 //        result << buildInfo;
 //    }
 
-    foreach (const QString& configuration, data->configurations()) {
+    foreach (const QString& configuration, configurations) {
         auto buildInfo = new VsBuildInfo(this);
         buildInfo->buildType = deriveBuildType(configuration);
         buildInfo->displayName = configuration;
@@ -250,10 +254,16 @@ ProjectExplorer::BuildConfiguration *VsBuildConfigurationFactory::create(Project
     ProjectExplorer::BuildStepList *buildSteps = bc->stepList(Core::Id(ProjectExplorer::Constants::BUILDSTEPS_BUILD));
 
 
-    // build
-    auto buildStep = new DevenvStep(buildSteps);
-    buildStep->setConfiguration(info->displayName);
-    buildSteps->insertStep(0, buildStep);
+    // build, the projects of a solution are built concurrently
+    if (parent->project()->projectFilePath().toString().endsWith(QLatin1String(".sln"), Qt::CaseInsensitive)) {
+        auto buildStep = new VsSolutionBuildStep(buildSteps);
+        buildStep->setConfiguration(info->displayName);
+        buildSteps->insertStep(0, buildStep);
+    } else {
+        auto buildStep = new DevenvStep(buildSteps);
+        buildStep->setConfiguration(info->displayName);
+        buildSteps->insertStep(0, buildStep);
+    }
 
     // clean
     ProjectExplorer::BuildStepList *cleanSteps = bc->stepList(Core::Id(ProjectExplorer::Constants::BUILDSTEPS_CLEAN));
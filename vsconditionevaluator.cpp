@@ -0,0 +1,456 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#include "vsconditionevaluator.h"
+
+#include <QFileInfo>
+
+namespace VsProjectManager {
+namespace Internal {
+
+namespace {
+
+struct Token
+{
+    enum Type {
+        End,
+        String,     // 'quoted'
+        Word,       // unquoted operand, keyword or function name
+        LeftParen,
+        RightParen,
+        Comma,
+        Bang,
+        Equal,
+        NotEqual,
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual,
+        Invalid
+    };
+
+    Type type = End;
+    QString text;
+};
+
+class Lexer
+{
+public:
+    explicit Lexer(const QString& input) : m_input(input) { }
+
+    Token next();
+
+private:
+    const QString& m_input;
+    int m_pos = 0;
+};
+
+Token Lexer::next()
+{
+    Token token;
+    const auto size = m_input.size();
+    while (m_pos < size && m_input.at(m_pos).isSpace()) {
+        ++m_pos;
+    }
+
+    if (m_pos >= size) {
+        return token;
+    }
+
+    auto c = m_input.at(m_pos);
+    auto peek = m_pos + 1 < size ? m_input.at(m_pos + 1) : QChar();
+    switch (c.unicode()) {
+    case '\'': {
+        auto close = m_input.indexOf(QLatin1Char('\''), m_pos + 1);
+        if (close < 0) {
+            token.type = Token::Invalid;
+            m_pos = size;
+        } else {
+            token.type = Token::String;
+            token.text = m_input.mid(m_pos + 1, close - m_pos - 1);
+            m_pos = close + 1;
+        }
+        return token;
+    }
+    case '(':
+        token.type = Token::LeftParen;
+        ++m_pos;
+        return token;
+    case ')':
+        token.type = Token::RightParen;
+        ++m_pos;
+        return token;
+    case ',':
+        token.type = Token::Comma;
+        ++m_pos;
+        return token;
+    case '!':
+        token.type = peek == QLatin1Char('=') ? Token::NotEqual : Token::Bang;
+        m_pos += token.type == Token::NotEqual ? 2 : 1;
+        return token;
+    case '=':
+        token.type = peek == QLatin1Char('=') ? Token::Equal : Token::Invalid;
+        m_pos += 2;
+        return token;
+    case '<':
+        token.type = peek == QLatin1Char('=') ? Token::LessEqual : Token::Less;
+        m_pos += token.type == Token::LessEqual ? 2 : 1;
+        return token;
+    case '>':
+        token.type = peek == QLatin1Char('=') ? Token::GreaterEqual : Token::Greater;
+        m_pos += token.type == Token::GreaterEqual ? 2 : 1;
+        return token;
+    }
+
+    // unquoted operand, $(...) references may contain any of the delimiters
+    auto start = m_pos;
+    while (m_pos < size) {
+        c = m_input.at(m_pos);
+        if (c == QLatin1Char('$') && m_pos + 1 < size && m_input.at(m_pos + 1) == QLatin1Char('(')) {
+            auto close = VsMacroExpander::findClose(m_input, m_pos + 2);
+            m_pos = close < 0 ? size : close + 1;
+            continue;
+        }
+
+        if (c.isSpace() || QStringLiteral("'(),!=<>").contains(c)) {
+            break;
+        }
+
+        ++m_pos;
+    }
+
+    token.type = Token::Word;
+    token.text = m_input.mid(start, m_pos - start);
+    return token;
+}
+
+bool isKeyword(const Token& token, const char* keyword)
+{
+    return token.type == Token::Word && token.text.compare(QLatin1String(keyword), Qt::CaseInsensitive) == 0;
+}
+
+bool toBool(const QString& value, bool* ok)
+{
+    *ok = true;
+    if (value.compare(QLatin1String("true"), Qt::CaseInsensitive) == 0
+            || value.compare(QLatin1String("on"), Qt::CaseInsensitive) == 0
+            || value.compare(QLatin1String("yes"), Qt::CaseInsensitive) == 0) {
+        return true;
+    }
+
+    if (value.compare(QLatin1String("false"), Qt::CaseInsensitive) == 0
+            || value.compare(QLatin1String("off"), Qt::CaseInsensitive) == 0
+            || value.compare(QLatin1String("no"), Qt::CaseInsensitive) == 0) {
+        return false;
+    }
+
+    *ok = false;
+    return false;
+}
+
+// MSBuild property names are case insensitive, conditions mostly spell them like their definitions
+QString propertyValue(const QHash<QString, QString>& properties, const QString& name)
+{
+    const auto key = QLatin1String("$(") + name + QLatin1Char(')');
+    auto it = properties.constFind(key);
+    if (it != properties.constEnd()) {
+        return it.value();
+    }
+
+    for (it = properties.constBegin(); it != properties.constEnd(); ++it) {
+        if (it.key().compare(key, Qt::CaseInsensitive) == 0) {
+            return it.value();
+        }
+    }
+    return QString();
+}
+
+double toNumber(const QString& value, bool* ok)
+{
+    if (value.startsWith(QLatin1String("0x"), Qt::CaseInsensitive)) {
+        return value.mid(2).toLongLong(ok, 16);
+    }
+
+    return value.toDouble(ok);
+}
+
+} // anon
+
+////////////////////////////////////////////////////////////////////////////////
+// Recursive descent parser, adds the nodes of one condition to the evaluator
+class VsConditionEvaluator::Parser
+{
+public:
+    Parser(VsConditionEvaluator& evaluator, const QString& condition)
+        : m_evaluator(evaluator)
+        , m_lexer(condition)
+    {
+        advance();
+    }
+
+    int parse()
+    {
+        auto root = parseOr();
+        return m_token.type == Token::End ? root : -1;
+    }
+
+private:
+    void advance() { m_token = m_lexer.next(); }
+
+    int parseOr()
+    {
+        auto lhs = parseAnd();
+        while (lhs >= 0 && isKeyword(m_token, "or")) {
+            advance();
+            auto rhs = parseAnd();
+            lhs = rhs < 0 ? -1 : m_evaluator.addNode(Node::Or, QString(), lhs, rhs);
+        }
+        return lhs;
+    }
+
+    int parseAnd()
+    {
+        auto lhs = parseUnary();
+        while (lhs >= 0 && isKeyword(m_token, "and")) {
+            advance();
+            auto rhs = parseUnary();
+            lhs = rhs < 0 ? -1 : m_evaluator.addNode(Node::And, QString(), lhs, rhs);
+        }
+        return lhs;
+    }
+
+    int parseUnary()
+    {
+        if (m_token.type == Token::Bang) {
+            advance();
+            auto operand = parseUnary();
+            return operand < 0 ? -1 : m_evaluator.addNode(Node::Not, QString(), operand);
+        }
+
+        if (m_token.type == Token::LeftParen) {
+            advance();
+            auto expression = parseOr();
+            if (expression < 0 || m_token.type != Token::RightParen) {
+                return -1;
+            }
+            advance();
+            return expression;
+        }
+
+        auto lhs = parseOperand();
+        if (lhs < 0) {
+            return -1;
+        }
+
+        Node::Kind kind;
+        switch (m_token.type) {
+        case Token::Equal:        kind = Node::Equal; break;
+        case Token::NotEqual:     kind = Node::NotEqual; break;
+        case Token::Less:         kind = Node::Less; break;
+        case Token::LessEqual:    kind = Node::LessEqual; break;
+        case Token::Greater:      kind = Node::Greater; break;
+        case Token::GreaterEqual: kind = Node::GreaterEqual; break;
+        default:
+            return lhs;
+        }
+
+        advance();
+        auto rhs = parseOperand();
+        return rhs < 0 ? -1 : m_evaluator.addNode(kind, QString(), lhs, rhs);
+    }
+
+    int parseOperand()
+    {
+        if (m_token.type == Token::String) {
+            auto node = m_evaluator.addNode(Node::Literal, m_token.text);
+            advance();
+            return node;
+        }
+
+        if (m_token.type != Token::Word || isKeyword(m_token, "and") || isKeyword(m_token, "or")) {
+            return -1;
+        }
+
+        auto word = m_token.text;
+        advance();
+        if (m_token.type != Token::LeftParen) {
+            return m_evaluator.addNode(Node::Literal, word);
+        }
+
+        Node::Kind kind;
+        if (word.compare(QLatin1String("Exists"), Qt::CaseInsensitive) == 0) {
+            kind = Node::Exists;
+        } else if (word.compare(QLatin1String("HasTrailingSlash"), Qt::CaseInsensitive) == 0) {
+            kind = Node::HasTrailingSlash;
+        } else {
+            return -1;
+        }
+
+        advance();
+        auto argument = parseOperand();
+        if (argument < 0 || m_token.type != Token::RightParen) {
+            return -1;
+        }
+        advance();
+        return m_evaluator.addNode(kind, QString(), argument);
+    }
+
+private:
+    VsConditionEvaluator& m_evaluator;
+    Lexer m_lexer;
+    Token m_token;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+VsConditionEvaluator::VsConditionEvaluator(const QDir& projectDirectory)
+    : m_projectDirectory(projectDirectory)
+{
+}
+
+int VsConditionEvaluator::compile(const QString& condition)
+{
+    auto it = m_conditionIds.constFind(condition);
+    if (it != m_conditionIds.constEnd()) {
+        return it.value();
+    }
+
+    int root;
+    if (condition.trimmed().isEmpty()) {
+        root = addNode(Node::True);
+    } else {
+        root = Parser(*this, condition).parse();
+        if (root < 0) {
+            qWarning("%s: %s", qPrintable(condition), "unsupported condition");
+        }
+    }
+
+    auto id = m_conditions.size();
+    m_conditions << Condition{ root, VsMacroExpander::referencedNames(condition) };
+    m_conditionIds.insert(condition, id);
+    return id;
+}
+
+bool VsConditionEvaluator::evaluate(int conditionId, const QHash<QString, QString>& properties)
+{
+    const auto& condition = m_conditions.at(conditionId);
+    if (condition.root < 0) {
+        return false;
+    }
+
+    // Nothing but the properties the condition refers to influences its result
+    auto key = QString::number(conditionId);
+    for (const auto& name : condition.references) {
+        key += QChar(QChar::Null);
+        key += propertyValue(properties, name);
+    }
+
+    auto it = m_results.constFind(key);
+    if (it != m_results.constEnd()) {
+        return it.value();
+    }
+
+    VsMacroExpander expander(properties, VsMacroExpander::DropUnknownMacros);
+    auto result = evaluateNode(condition.root, expander);
+    m_results.insert(key, result);
+    return result;
+}
+
+int VsConditionEvaluator::addNode(Node::Kind kind, const QString& text, int lhs, int rhs)
+{
+    Node node;
+    node.kind = kind;
+    node.text = text;
+    node.lhs = lhs;
+    node.rhs = rhs;
+    m_nodes << node;
+    return m_nodes.size() - 1;
+}
+
+QString VsConditionEvaluator::evaluateOperand(int node, VsMacroExpander& properties)
+{
+    return properties.expand(m_nodes.at(node).text);
+}
+
+bool VsConditionEvaluator::evaluateNode(int index, VsMacroExpander& properties)
+{
+    const auto& node = m_nodes.at(index);
+    switch (node.kind) {
+    case Node::True:
+        return true;
+    case Node::Literal: {
+        bool ok;
+        return toBool(evaluateOperand(index, properties), &ok);
+    }
+    case Node::Exists: {
+        auto path = evaluateOperand(node.lhs, properties).trimmed();
+        return !path.isEmpty() && QFileInfo(m_projectDirectory, QDir::fromNativeSeparators(path)).exists();
+    }
+    case Node::HasTrailingSlash: {
+        auto path = evaluateOperand(node.lhs, properties);
+        return path.endsWith(QLatin1Char('/')) || path.endsWith(QLatin1Char('\\'));
+    }
+    case Node::Not:
+        return !evaluateNode(node.lhs, properties);
+    case Node::And:
+        return evaluateNode(node.lhs, properties) && evaluateNode(node.rhs, properties);
+    case Node::Or:
+        return evaluateNode(node.lhs, properties) || evaluateNode(node.rhs, properties);
+    case Node::Equal:
+    case Node::NotEqual: {
+        auto lhs = evaluateOperand(node.lhs, properties);
+        auto rhs = evaluateOperand(node.rhs, properties);
+        auto equal = lhs.compare(rhs, Qt::CaseInsensitive) == 0;
+        return node.kind == Node::Equal ? equal : !equal;
+    }
+    case Node::Less:
+    case Node::LessEqual:
+    case Node::Greater:
+    case Node::GreaterEqual: {
+        bool lhsOk, rhsOk;
+        auto lhs = toNumber(evaluateOperand(node.lhs, properties), &lhsOk);
+        auto rhs = toNumber(evaluateOperand(node.rhs, properties), &rhsOk);
+        if (!lhsOk || !rhsOk) {
+            return false;
+        }
+
+        switch (node.kind) {
+        case Node::Less:
+            return lhs < rhs;
+        case Node::LessEqual:
+            return lhs <= rhs;
+        case Node::Greater:
+            return lhs > rhs;
+        default:
+            return lhs >= rhs;
+        }
+    }
+    }
+
+    return false;
+}
+
+} // namespace Internal
+} // namespace VsProjectManager
@@ -0,0 +1,106 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#pragma once
+
+#include "vsmacroexpander.h"
+
+#include <QDir>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace VsProjectManager {
+namespace Internal {
+
+// Compiles MSBuild Condition attributes into a small expression tree and
+// evaluates them against the properties defined at the point they occur.
+//
+// Supported are quoted and unquoted operands, ==, !=, <, >, <=, >=, !, And,
+// Or, parentheses as well as the Exists() and HasTrailingSlash() functions.
+// Each distinct condition text is compiled once, results are cached by the
+// values of the properties the condition refers to. Conditions which fail to
+// compile are false.
+class VsConditionEvaluator
+{
+public:
+    explicit VsConditionEvaluator(const QDir& projectDirectory);
+
+    // Returns the id of the compiled condition, an empty condition is true
+    int compile(const QString& condition);
+    // Names of the properties the condition refers to
+    const QStringList& references(int conditionId) const { return m_conditions.at(conditionId).references; }
+    // properties are keyed as $(Name)
+    bool evaluate(int conditionId, const QHash<QString, QString>& properties);
+
+private:
+    struct Node
+    {
+        enum Kind {
+            True,
+            Literal,
+            Exists,
+            HasTrailingSlash,
+            Not,
+            And,
+            Or,
+            Equal,
+            NotEqual,
+            Less,
+            LessEqual,
+            Greater,
+            GreaterEqual
+        };
+
+        Kind kind;
+        QString text;
+        int lhs;
+        int rhs;
+    };
+
+    struct Condition
+    {
+        int root; // -1 if invalid
+        QStringList references;
+    };
+
+    class Parser;
+
+    int addNode(Node::Kind kind, const QString& text = QString(), int lhs = -1, int rhs = -1);
+    bool evaluateNode(int node, VsMacroExpander& properties);
+    QString evaluateOperand(int node, VsMacroExpander& properties);
+
+private:
+    QDir m_projectDirectory;
+    QVector<Node> m_nodes;
+    QVector<Condition> m_conditions; // by condition id
+    QHash<QString, int> m_conditionIds;
+    QHash<QString, bool> m_results;  // by condition id and the values of its references
+};
+
+} // namespace Internal
+} // namespace VsProjectManager
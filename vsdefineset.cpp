@@ -0,0 +1,181 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#include "vsdefineset.h"
+
+#include <QDataStream>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWeakPointer>
+
+#include <algorithm>
+
+namespace VsProjectManager {
+namespace Internal {
+
+namespace {
+
+QMutex s_mutex; // guards the registry and lazy rendering
+QMultiHash<uint, QWeakPointer<const void>> s_registry;
+const int MinimumPruneSize = 1024;
+int s_pruneSize = MinimumPruneSize; // dead entries are removed at this size
+
+// Sets are released by their last user, their entries are removed as the registry grows
+void pruneRegistry()
+{
+    for (auto it = s_registry.begin(); it != s_registry.end(); ) {
+        if (it.value().isNull()) {
+            it = s_registry.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    s_pruneSize = qMax(MinimumPruneSize, 2 * s_registry.size());
+}
+
+} // anon
+
+void VsDefineSet::Builder::add(const QByteArray& name, const QByteArray& value)
+{
+    if (!name.isEmpty()) {
+        m_defines << qMakePair(name, value);
+    }
+}
+
+void VsDefineSet::Builder::addDefinition(const QString& definition)
+{
+    auto bytes = definition.trimmed().toLocal8Bit();
+    auto equals = bytes.indexOf('=');
+    if (equals < 0) {
+        add(bytes);
+    } else {
+        add(bytes.left(equals).trimmed(), bytes.mid(equals + 1));
+    }
+}
+
+VsDefineSet VsDefineSet::Builder::build() const
+{
+    return fromDefines(m_defines);
+}
+
+VsDefineSet::VsDefineSet()
+{
+    static const QSharedPointer<const Data> empty(new Data());
+    d = empty;
+}
+
+VsDefineSet VsDefineSet::fromDefines(QVector<Define> defines)
+{
+    // stable, so the last definition of a name ends up last among its equals
+    std::stable_sort(defines.begin(), defines.end(), [](const Define& lhs, const Define& rhs) {
+        return lhs.first < rhs.first;
+    });
+
+    QVector<Define> unique;
+    unique.reserve(defines.size());
+    for (const auto& define : defines) {
+        if (!unique.isEmpty() && unique.last().first == define.first) {
+            unique.last().second = define.second;
+        } else {
+            unique << define;
+        }
+    }
+
+    if (unique.isEmpty()) {
+        return VsDefineSet();
+    }
+
+    uint hash = 0;
+    for (const auto& define : unique) {
+        hash = 31 * hash + ::qHash(define.first);
+        hash = 31 * hash + ::qHash(define.second);
+    }
+
+    QMutexLocker locker(&s_mutex);
+    for (auto it = s_registry.find(hash); it != s_registry.end() && it.key() == hash; ) {
+        auto data = it.value().toStrongRef().staticCast<const Data>();
+        if (!data) {
+            it = s_registry.erase(it);
+            continue;
+        }
+
+        if (data->defines == unique) {
+            return VsDefineSet(data);
+        }
+        ++it;
+    }
+
+    auto data = new Data();
+    data->defines = unique;
+    data->hash = hash;
+    QSharedPointer<const Data> shared(data);
+    s_registry.insert(hash, shared.staticCast<const void>());
+    if (s_registry.size() >= s_pruneSize) {
+        pruneRegistry();
+    }
+    return VsDefineSet(shared);
+}
+
+QByteArray VsDefineSet::toByteArray() const
+{
+    QMutexLocker locker(&s_mutex);
+    if (!d->rendered) {
+        for (const auto& define : d->defines) {
+            d->text += "#define ";
+            d->text += define.first;
+            if (!define.second.isEmpty()) {
+                d->text += ' ';
+                d->text += define.second;
+            }
+            d->text += '\n';
+        }
+        d->rendered = true;
+    }
+
+    return d->text;
+}
+
+bool VsDefineSet::operator==(const VsDefineSet& other) const
+{
+    return d == other.d || (d->hash == other.d->hash && d->defines == other.d->defines);
+}
+
+QDataStream& operator<<(QDataStream& stream, const VsDefineSet& defines)
+{
+    return stream << defines.defines();
+}
+
+QDataStream& operator>>(QDataStream& stream, VsDefineSet& defines)
+{
+    QVector<VsDefineSet::Define> values;
+    stream >> values;
+    defines = VsDefineSet::fromDefines(values);
+    return stream;
+}
+
+} // namespace Internal
+} // namespace VsProjectManager
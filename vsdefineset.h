@@ -0,0 +1,93 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#pragma once
+
+#include <QByteArray>
+#include <QPair>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+QT_FORWARD_DECLARE_CLASS(QDataStream)
+
+namespace VsProjectManager {
+namespace Internal {
+
+// Immutable set of preprocessor defines sorted by name. Equal sets share one
+// instance process wide, so comparing them is cheap. The "#define" text the
+// code model consumes is rendered on first use.
+class VsDefineSet
+{
+public:
+    typedef QPair<QByteArray, QByteArray> Define; // name, value
+
+    class Builder
+    {
+    public:
+        void add(const QByteArray& name, const QByteArray& value = QByteArray());
+        // NAME or NAME=VALUE as found in PreprocessorDefinitions
+        void addDefinition(const QString& definition);
+        VsDefineSet build() const;
+
+    private:
+        QVector<Define> m_defines;
+    };
+
+    VsDefineSet();
+
+    // Later definitions of the same name replace earlier ones
+    static VsDefineSet fromDefines(QVector<Define> defines);
+
+    bool isEmpty() const { return d->defines.isEmpty(); }
+    const QVector<Define>& defines() const { return d->defines; }
+    uint hash() const { return d->hash; }
+    QByteArray toByteArray() const;
+
+    bool operator==(const VsDefineSet& other) const;
+    bool operator!=(const VsDefineSet& other) const { return !(*this == other); }
+
+private:
+    struct Data
+    {
+        QVector<Define> defines;
+        uint hash = 0;
+        mutable QByteArray text;
+        mutable bool rendered = false;
+    };
+
+    explicit VsDefineSet(const QSharedPointer<const Data>& data) : d(data) { }
+
+    QSharedPointer<const Data> d;
+};
+
+inline uint qHash(const VsDefineSet& defines) { return defines.hash(); }
+
+QDataStream& operator<<(QDataStream& stream, const VsDefineSet& defines);
+QDataStream& operator>>(QDataStream& stream, VsDefineSet& defines);
+
+} // namespace Internal
+} // namespace VsProjectManager
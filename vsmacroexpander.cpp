@@ -0,0 +1,210 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#include "vsmacroexpander.h"
+#include "vspropertyfunctions.h"
+
+#include <algorithm>
+
+namespace VsProjectManager {
+namespace Internal {
+
+namespace {
+const QString Empty;
+
+bool isNameChar(QChar c)
+{
+    return c.isLetterOrNumber() || c == QLatin1Char('_') || c == QLatin1Char('-');
+}
+
+} // anon
+
+int VsMacroExpander::findClose(const QString& input, int pos)
+{
+    auto depth = 0;
+    QChar quote;
+    for (; pos < input.size(); ++pos) {
+        auto c = input.at(pos);
+        if (!quote.isNull()) {
+            if (c == quote) {
+                quote = QChar();
+            }
+        } else if (c == QLatin1Char('\'') || c == QLatin1Char('"') || c == QLatin1Char('`')) {
+            quote = c;
+        } else if (c == QLatin1Char('(')) {
+            ++depth;
+        } else if (c == QLatin1Char(')')) {
+            if (depth == 0) {
+                return pos;
+            }
+            --depth;
+        }
+    }
+    return -1;
+}
+
+QStringList VsMacroExpander::referencedNames(const QString& input)
+{
+    QStringList names;
+    for (auto start = input.indexOf(QLatin1String("$(")); start >= 0; start = input.indexOf(QLatin1String("$("), start + 2)) {
+        auto end = start + 2;
+        while (end < input.size() && isNameChar(input.at(end))) {
+            ++end;
+        }
+
+        // e.g. $([MSBuild]::Add(1, 2)) refers to nothing
+        auto name = input.mid(start + 2, end - start - 2);
+        if (!name.isEmpty() && !names.contains(name, Qt::CaseInsensitive)) {
+            names << name;
+        }
+    }
+    return names;
+}
+
+VsMacroExpander::VsMacroExpander(const QHash<QString, QString>& macros, UnknownMacros unknownMacros)
+    : m_unknownMacros(unknownMacros)
+{
+    m_macros.reserve(macros.size());
+    for (auto it = macros.cbegin(); it != macros.cend(); ++it) {
+        const auto& key = it.key();
+        if (key.size() > 3 && key.startsWith(QLatin1String("$(")) && key.endsWith(QLatin1Char(')'))) {
+            // MSBuild property names are case insensitive
+            m_macros[key.mid(2, key.size() - 3).toLower()].value = it.value();
+        }
+    }
+}
+
+QString VsMacroExpander::expand(const QString& input)
+{
+    QString output;
+    output.reserve(input.size());
+    expandInto(input, output);
+    return output;
+}
+
+void VsMacroExpander::expandInto(const QString& input, QString& output)
+{
+    auto pos = 0;
+    while (true) {
+        auto start = input.indexOf(QLatin1String("$("), pos);
+        if (start < 0) {
+            break;
+        }
+
+        auto close = input.indexOf(QLatin1Char(')'), start + 2);
+        if (close < 0) {
+            break;
+        }
+
+        output.append(input.midRef(pos, start - pos));
+
+        auto name = input.midRef(start + 2, close - start - 2);
+        if (std::all_of(name.begin(), name.end(), isNameChar)) {
+            auto it = m_macros.find(name.toString().toLower());
+            if (it == m_macros.end()) {
+                if (m_unknownMacros == KeepUnknownMacros) {
+                    output.append(input.midRef(start, close + 1 - start));
+                }
+            } else {
+                output.append(resolve(it.value()));
+            }
+        } else {
+            auto functionClose = findClose(input, start + 2);
+            if (functionClose >= 0) {
+                close = functionClose;
+            }
+            if (!expandFunction(input.mid(start + 2, close - start - 2), output) && m_unknownMacros == KeepUnknownMacros) {
+                output.append(input.midRef(start, close + 1 - start));
+            }
+        }
+
+        pos = close + 1;
+    }
+
+    output.append(input.midRef(pos));
+}
+
+// The arguments are split as written, then the properties each one refers to
+// are expanded. The function itself is evaluated on plain text.
+bool VsMacroExpander::expandFunction(const QString& expression, QString& output)
+{
+    auto nameEnd = 0;
+    while (nameEnd < expression.size() && isNameChar(expression.at(nameEnd))) {
+        ++nameEnd;
+    }
+
+    // e.g. Configuration in $(Configuration.ToLower()), undefined properties are empty
+    QString receiver;
+    if (nameEnd > 0) {
+        auto it = m_macros.find(expression.left(nameEnd).toLower());
+        if (it != m_macros.end()) {
+            receiver = resolve(it.value());
+        }
+    }
+
+    QString baseDirectory;
+    auto it = m_macros.find(QStringLiteral("projectdir"));
+    if (it != m_macros.end()) {
+        baseDirectory = resolve(it.value());
+    }
+
+    auto expandArgument = [this](const QString& argument) {
+        QString expanded;
+        expandInto(argument, expanded);
+        return expanded;
+    };
+
+    QString result;
+    if (!VsPropertyFunctions::evaluate(expression, receiver, baseDirectory, expandArgument, &result)) {
+        return false;
+    }
+
+    output.append(result);
+    return true;
+}
+
+const QString& VsMacroExpander::resolve(Macro& macro)
+{
+    switch (macro.state) {
+    case Resolved:
+        return macro.value;
+    case Resolving:
+        // cycle, e.g. OutDir = $(OutDir)sub\ without a previous definition
+        return Empty;
+    case Unresolved:
+        break;
+    }
+
+    macro.state = Resolving;
+    QString expanded;
+    expandInto(macro.value, expanded);
+    macro.value = expanded;
+    macro.state = Resolved;
+    return macro.value;
+}
+
+} // namespace Internal
+} // namespace VsProjectManager
@@ -0,0 +1,82 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+namespace VsProjectManager {
+namespace Internal {
+
+// Expands $(Name) references. Every macro value is expanded at most once and
+// memoized, references to a macro which is currently being expanded resolve
+// to an empty string. Property functions like $(Name.ToLower()) are evaluated
+// by VsPropertyFunctions.
+class VsMacroExpander
+{
+public:
+    enum UnknownMacros {
+        KeepUnknownMacros,  // leave $(Name) in the output
+        DropUnknownMacros   // expand to an empty string, like MSBuild does
+    };
+
+    // keys are given as $(Name)
+    explicit VsMacroExpander(const QHash<QString, QString>& macros, UnknownMacros unknownMacros = KeepUnknownMacros);
+
+    QString expand(const QString& input);
+
+    // Position of the ')' closing the reference which starts before pos, -1 if there is none.
+    // Property functions nest parentheses, quoted arguments may contain any of them.
+    static int findClose(const QString& input, int pos);
+    // Names of the properties input refers to, including those in function arguments
+    static QStringList referencedNames(const QString& input);
+
+private:
+    enum State {
+        Unresolved,
+        Resolving,
+        Resolved
+    };
+
+    struct Macro
+    {
+        QString value;
+        State state = Unresolved;
+    };
+
+    void expandInto(const QString& input, QString& output);
+    bool expandFunction(const QString& expression, QString& output);
+    const QString& resolve(Macro& macro);
+
+private:
+    QHash<QString, Macro> m_macros; // by lower case name
+    UnknownMacros m_unknownMacros;
+};
+
+} // namespace Internal
+} // namespace VsProjectManager
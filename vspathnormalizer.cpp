@@ -0,0 +1,244 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#include "vspathnormalizer.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPair>
+#include <QVarLengthArray>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   include <emmintrin.h>
+#   define VSPATH_SSE2
+#endif
+
+namespace VsProjectManager {
+namespace Internal {
+
+namespace {
+
+// Projects are loaded concurrently, spread the memo over several locks
+const int ShardCount = 16;
+// A shard is dropped once it holds that many paths, which bounds the memory
+const int MaxShardSize = 8192;
+
+typedef QPair<QString, QString> MemoKey;
+
+struct Shard
+{
+    QMutex mutex;
+    QHash<MemoKey, QString> paths;
+};
+
+Shard s_shards[ShardCount];
+
+bool isSlash(QChar c)
+{
+    return c == QLatin1Char('/');
+}
+
+} // anon
+
+void VsPathNormalizer::toForwardSlashes(QString& path)
+{
+    auto begin = reinterpret_cast<const ushort*>(path.constData());
+    auto end = begin + path.size();
+    auto p = begin;
+
+#ifdef VSPATH_SSE2
+    // Only detach if there is anything to replace
+    const __m128i backslash = _mm_set1_epi16('\\');
+    for (; end - p >= 8; p += 8) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(chunk, backslash))) {
+            break;
+        }
+    }
+#endif
+    while (p != end && *p != '\\') {
+        ++p;
+    }
+    if (p == end) {
+        return;
+    }
+
+    const auto offset = p - begin;
+    auto data = reinterpret_cast<ushort*>(path.data());
+    auto q = data + offset;
+    auto qend = data + path.size();
+
+#ifdef VSPATH_SSE2
+    const __m128i slash = _mm_set1_epi16('/');
+    for (; qend - q >= 8; q += 8) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(q));
+        const __m128i hits = _mm_cmpeq_epi16(chunk, backslash);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(q),
+                         _mm_or_si128(_mm_and_si128(hits, slash), _mm_andnot_si128(hits, chunk)));
+    }
+#endif
+    for (; q != qend; ++q) {
+        if (*q == '\\') {
+            *q = '/';
+        }
+    }
+}
+
+// Paths starting with a slash or a drive letter are not resolved against a directory
+bool VsPathNormalizer::isAbsolutePath(const QString& path)
+{
+    if (path.isEmpty()) {
+        return false;
+    }
+
+    if (isSlash(path.at(0))) {
+        return true;
+    }
+
+    return path.size() >= 2 && path.at(1) == QLatin1Char(':') && path.at(0).isLetter();
+}
+
+// Expects slashes. Folds like QDir::cleanPath() on Windows: the root, i.e. a
+// leading slash, a drive or the //server/ of a UNC path, is kept as it is,
+// ".." which can't be folded is kept even above the root, a trailing slash is
+// only kept for roots and empty results become ".".
+QString VsPathNormalizer::cleanPath(const QString& path)
+{
+    if (path.isEmpty()) {
+        return path;
+    }
+
+    const auto in = path.constData();
+    const auto size = path.size();
+
+    auto prefixSize = 0;
+    if (size >= 2 && isSlash(in[0]) && isSlash(in[1])) {
+        const auto serverEnd = path.indexOf(QLatin1Char('/'), 2);
+        prefixSize = serverEnd >= 0 ? serverEnd + 1 : size;
+    } else if (size >= 2 && in[1] == QLatin1Char(':')) {
+        prefixSize = size > 2 && isSlash(in[2]) ? 3 : 2;
+    } else if (isSlash(in[0])) {
+        prefixSize = 1;
+    }
+
+    // (start, length) of the segments kept, those of leading ".." first
+    QVarLengthArray<QPair<int, int>, 32> segments;
+    auto parents = 0;
+    auto folded = prefixSize < size && isSlash(in[size - 1]);
+    auto pos = prefixSize;
+    while (pos < size) {
+        auto end = pos;
+        while (end < size && !isSlash(in[end])) {
+            ++end;
+        }
+
+        const QPair<int, int> segment(pos, end - pos);
+        if (segment.second == 0 || (segment.second == 1 && in[pos] == QLatin1Char('.'))) {
+            folded = true; // empty or current directory
+        } else if (segment.second == 2 && in[pos] == QLatin1Char('.') && in[pos + 1] == QLatin1Char('.')) {
+            if (segments.size() > parents) {
+                segments.removeLast();
+                folded = true;
+            } else {
+                segments.append(segment);
+                ++parents;
+            }
+        } else {
+            segments.append(segment);
+        }
+
+        pos = end + 1;
+    }
+
+    // Fast path, nothing to fold
+    if (!folded && prefixSize < size) {
+        return path;
+    }
+
+    QString result;
+    result.reserve(size);
+    result.append(in, prefixSize);
+    for (auto i = 0; i < segments.size(); ++i) {
+        if (i) {
+            result.append(QLatin1Char('/'));
+        }
+        result.append(in + segments.at(i).first, segments.at(i).second);
+    }
+    // QDir::cleanPath() keeps the trailing slash up to here, which matters if the
+    // result happens to look like a drive root, e.g. for "a/../C:/"
+    if (!segments.isEmpty() && size - prefixSize >= 2 && isSlash(in[size - 1])) {
+        result.append(QLatin1Char('/'));
+    }
+
+    if (result.isEmpty()) {
+        return QString(QLatin1Char('.'));
+    }
+    if (result.size() > 1 && isSlash(result.at(result.size() - 1))
+            && !(result.size() == 3 && result.at(1) == QLatin1Char(':'))) {
+        result.chop(1);
+    }
+    return result;
+}
+
+QString VsPathNormalizer::absoluteFilePath(const QString& baseDirectory, const QString& path)
+{
+    const MemoKey key(baseDirectory, path);
+    auto& shard = s_shards[qHash(key) % ShardCount];
+    {
+        QMutexLocker locker(&shard.mutex);
+        auto it = shard.paths.constFind(key);
+        if (it != shard.paths.constEnd()) {
+            return it.value();
+        }
+    }
+
+    auto result = path;
+    toForwardSlashes(result);
+    if (!isAbsolutePath(result) && !baseDirectory.isEmpty()) {
+        result = isSlash(baseDirectory.at(baseDirectory.size() - 1))
+                ? baseDirectory + result
+                : baseDirectory + QLatin1Char('/') + result;
+    }
+    result = cleanPath(result);
+
+    QMutexLocker locker(&shard.mutex);
+    if (shard.paths.size() >= MaxShardSize) {
+        shard.paths.clear();
+    }
+    shard.paths.insert(key, result);
+    return result;
+}
+
+void VsPathNormalizer::absoluteFilePaths(const QString& baseDirectory, QStringList& paths)
+{
+    for (auto& path : paths) {
+        path = absoluteFilePath(baseDirectory, path);
+    }
+}
+
+} // namespace Internal
+} // namespace VsProjectManager
@@ -0,0 +1,54 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+namespace VsProjectManager {
+namespace Internal {
+
+// Makes the paths found in project files absolute and clean without asking
+// the file system. Backslashes are converted to slashes several characters at
+// a time where SSE2 is available, "." and ".." segments are folded like
+// QDir::cleanPath() does on Windows. Results are memoized per base directory
+// and path, the memo is shared by all threads.
+class VsPathNormalizer
+{
+public:
+    // baseDirectory must be absolute and use slashes, e.g. QDir::absolutePath()
+    static QString absoluteFilePath(const QString& baseDirectory, const QString& path);
+    static void absoluteFilePaths(const QString& baseDirectory, QStringList& paths);
+
+    // The building blocks, not memoized
+    static void toForwardSlashes(QString& path);
+    static bool isAbsolutePath(const QString& path);
+    static QString cleanPath(const QString& path);
+};
+
+} // namespace Internal
+} // namespace VsProjectManager
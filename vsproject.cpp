@@ -31,6 +31,8 @@
 #include "vsprojectnode.h"
 #include "vsprojectfile.h"
 #include "vsprojectdata.h"
+#include "vsprojectdatacache.h"
+#include "vsprojectdataregistry.h"
 #include "vsrunconfiguration.h"
 
 #include <projectexplorer/abi.h>
@@ -52,18 +54,22 @@
 #include <coreplugin/icore.h>
 #include <coreplugin/icontext.h>
 #include <coreplugin/fileiconprovider.h>
+#include <coreplugin/progressmanager/progressmanager.h>
 #include <qtsupport/baseqtversion.h>
 #include <qtsupport/qtkitinformation.h>
 #include <utils/qtcassert.h>
 #include <utils/filesystemwatcher.h>
 #include <utils/algorithm.h>
+#include <utils/runextensions.h>
 #include <utils/stringutils.h>
 
 #include <QFileInfo>
 #include <QTimer>
 #include <QPointer>
-#include <QApplication>
-#include <QCursor>
+#include <QScopedPointer>
+#include <QCoreApplication>
+#include <QFile>
+#include <QTextStream>
 #include <QLabel>
 #include <QPushButton>
 #include <QVBoxLayout>
@@ -71,12 +77,61 @@
 using namespace VsProjectManager;
 using namespace VsProjectManager::Internal;
 
+namespace {
+
+void parseProjectData(
+        QFutureInterface<VsProjectDataPtr>& futureInterface,
+        const Utils::FileName& projectFilePath,
+        const VsProjectDataPtr& previous,
+        const QStringList& changedFiles,
+        const QString& activeConfiguration)
+{
+    futureInterface.setProgressRange(0, 1);
+
+    // A newer change supersedes this load, the steps left are skipped
+    VsProjectDataPtr data;
+    if (previous && !changedFiles.isEmpty()) {
+        QScopedPointer<VsProjectData> reloaded(VsProjectData::reload(*previous, changedFiles));
+        if (futureInterface.isCanceled())
+            return;
+        if (reloaded) {
+            VsProjectDataCache::store(*reloaded);
+            data = VsProjectDataRegistry::publish(reloaded.take(), VsProjectDataRegistry::ReplaceExisting);
+        }
+    } else {
+        data = VsProjectDataRegistry::acquire(projectFilePath);
+    }
+
+    // The registry lets go of the instance once nobody else uses it
+    if (futureInterface.isCanceled())
+        return;
+
+    // Targets are evaluated on demand, the one needed right away is evaluated here
+    if (data && !activeConfiguration.isEmpty()) {
+        data->targets(activeConfiguration);
+        if (futureInterface.isCanceled())
+            return;
+    }
+
+    futureInterface.reportResult(data);
+    futureInterface.setProgressValue(1);
+}
+
+int reloadDelay(const char* envVarName, int defaultValue)
+{
+    bool ok = false;
+    auto value = qgetenv(envVarName).toInt(&ok);
+    return ok && value >= 0 ? value : defaultValue;
+}
+
+} // namespace
+
 VsProject::~VsProject()
 {
     setRootProjectNode(nullptr);
 
+    m_parseFuture.cancel();
     m_codeModelFuture.cancel();
-    delete m_vsProjectData;
 }
 
 VsProject::VsProject(VsManager *manager, const QString &fileName) :
@@ -95,6 +150,13 @@ VsProject::VsProject(VsManager *manager, const QString &fileName) :
 
     connect(this, &VsProject::activeTargetChanged, this, &VsProject::handleActiveTargetChanged);
     connect(m_fileWatcher, &Utils::FileSystemWatcher::fileChanged, this, &VsProject::onFileChanged);
+    connect(m_fileWatcher, &Utils::FileSystemWatcher::directoryChanged, this, &VsProject::onFileChanged);
+    connect(&m_parseFutureWatcher, &QFutureWatcher<VsProjectDataPtr>::finished, this, &VsProject::parsingFinished);
+
+    m_reloadTimer.setSingleShot(true);
+    connect(&m_reloadTimer, &QTimer::timeout, this, &VsProject::reloadTimeout);
+    setReloadDelays(reloadDelay("QTC_VSPROJECTMANAGER_RELOAD_DELAY", Constants::RELOAD_QUIET_PERIOD),
+                    reloadDelay("QTC_VSPROJECTMANAGER_RELOAD_MAX_DELAY", Constants::RELOAD_MAX_DELAY));
 
     loadProjectTree();
 }
@@ -153,42 +215,53 @@ ProjectExplorer::Project::RestoreResult VsProject::fromMap(const QVariantMap &ma
 
 void VsProject::loadProjectTree()
 {
-    parsingStarted();
-
-    if (m_vsProjectData) {
-        m_fileWatcher->removeFiles(m_vsProjectData->filesToWatch());
-    } else {
-        m_fileWatcher->removeFile(projectFilePath().toString());
-    }
+    // A newer change supersedes any load still in progress
+    m_parseFuture.cancel();
+    QString activeConfiguration;
+    if (activeTarget() && activeTarget()->activeBuildConfiguration())
+        activeConfiguration = activeTarget()->activeBuildConfiguration()->displayName();
+    m_parseFuture = Utils::runAsync(parseProjectData, projectFilePath(), m_vsProjectData, m_changedFiles, activeConfiguration);
+    m_parseFutureWatcher.setFuture(m_parseFuture);
+
+    Core::ProgressManager::addTask(m_parseFuture,
+                                   tr("Parsing \"%1\"").arg(projectFilePath().fileName()),
+                                   Constants::PARSE_TASK_ID);
+}
 
-    delete m_vsProjectData;
-    m_vsProjectData = VsProjectData::load(projectFilePath());
+void VsProject::parsingFinished()
+{
+    if (m_parseFuture.isCanceled() || m_parseFuture.resultCount() == 0)
+        return;
 
-    if (m_vsProjectData) {
-        m_fileWatcher->addFiles(m_vsProjectData->filesToWatch(), Utils::FileSystemWatcher::WatchAllChanges);
-    } else {
-        m_fileWatcher->addFile(projectFilePath().toString(), Utils::FileSystemWatcher::WatchAllChanges);
-    }
+    m_fileWatcher->removeFiles(m_watchedFiles);
+    m_fileWatcher->removeDirectories(m_watchedDirectories);
 
-    parsingFinished();
-}
+    auto previous = m_vsProjectData;
+    m_vsProjectData = m_parseFuture.result();
+    m_parseFuture = QFuture<VsProjectDataPtr>();
+    m_changedFiles.clear();
 
-void VsProject::parsingStarted()
-{
-    QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
-}
+    m_watchedFiles = m_vsProjectData ? m_vsProjectData->filesToWatch() : QStringList(projectFilePath().toString());
+    m_fileWatcher->addFiles(m_watchedFiles, Utils::FileSystemWatcher::WatchAllChanges);
+    // Files matched by wildcard items come and go with the directories they are in
+    m_watchedDirectories = m_vsProjectData ? m_vsProjectData->directoriesToWatch() : QStringList();
+    m_fileWatcher->addDirectories(m_watchedDirectories, Utils::FileSystemWatcher::WatchAllChanges);
 
-void VsProject::parsingFinished()
-{
-    QApplication::restoreOverrideCursor();
+    auto parts = m_vsProjectData ? m_vsProjectData->recomputedParts() : VsProjectData::AllParts;
+    auto filesChanged = !previous || !m_vsProjectData
+            || previous->files().toSet() != m_vsProjectData->files().toSet();
 
     buildTree();
 
-    emit fileListChanged();
+    if (filesChanged)
+        emit fileListChanged();
 
-    updateApplicationAndDeploymentTargets();
+    if (parts & VsProjectData::TargetsPart)
+        updateApplicationAndDeploymentTargets();
 
-    onTargetChanged();
+    // Reorganized filters leave the code model as it is
+    if ((parts & VsProjectData::TargetsPart) || filesChanged)
+        onTargetChanged();
 }
 
 void VsProject::onTargetChanged()
@@ -197,12 +270,56 @@ void VsProject::onTargetChanged()
         updateTargetRunConfigurations(t);
 
         updateCppCodeModel();
+        updateWatchedFiles();
+    }
+}
+
+// Property sheets become known as targets are evaluated, they are watched from then on
+void VsProject::updateWatchedFiles()
+{
+    if (!m_vsProjectData)
+        return;
+
+    QStringList addedFiles;
+    foreach (const QString &filePath, m_vsProjectData->filesToWatch()) {
+        if (!m_watchedFiles.contains(filePath))
+            addedFiles << filePath;
     }
+
+    if (!addedFiles.isEmpty()) {
+        m_watchedFiles << addedFiles;
+        m_fileWatcher->addFiles(addedFiles, Utils::FileSystemWatcher::WatchAllChanges);
+    }
+}
+
+void VsProject::setReloadDelays(int quietPeriod, int maxDelay)
+{
+    m_reloadQuietPeriod = quietPeriod;
+    m_reloadMaxDelay = qMax(quietPeriod, maxDelay);
 }
 
+// Editors and version control write project files in several steps. Wait until
+// the files have been quiet for a while, but don't postpone the reload forever.
 void VsProject::onFileChanged(const QString &file)
 {
-    Q_UNUSED(file);
+    ++m_fileChangeEvents;
+
+    // Changes stay pending until a load picking them up has finished
+    if (!m_changedFiles.contains(file))
+        m_changedFiles << file;
+
+    if (m_firstPendingChange.isValid())
+        ++m_mergedFileChangeEvents;
+    else
+        m_firstPendingChange.start();
+
+    auto remaining = m_reloadMaxDelay - static_cast<int>(m_firstPendingChange.elapsed());
+    m_reloadTimer.start(qBound(0, remaining, m_reloadQuietPeriod));
+}
+
+void VsProject::reloadTimeout()
+{
+    m_firstPendingChange.invalidate();
     loadProjectTree();
 }
 
@@ -216,27 +333,63 @@ bool VsProject::requiresTargetPanel() const
     return !targets().isEmpty();
 }
 
+bool VsProject::CodeModelInputs::operator==(const CodeModelInputs &other) const
+{
+    if (kitId != other.kitId
+            || qtVersion != other.qtVersion
+            || targets.size() != other.targets.size()
+            || sourceFiles != other.sourceFiles
+            || fileSettings != other.fileSettings)
+        return false;
+
+    for (int i = 0; i < targets.size(); ++i) {
+        const VsBuildTarget &target = targets.at(i);
+        const VsBuildTarget &otherTarget = other.targets.at(i);
+        if (target.title != otherTarget.title
+                || !(target.defines == otherTarget.defines)
+                || target.includeDirectories != otherTarget.includeDirectories
+                || target.compilerOptions != otherTarget.compilerOptions)
+            return false;
+    }
+    return true;
+}
+
 void VsProject::updateCppCodeModel()
 {
     CppTools::CppModelManager *modelManager = CppTools::CppModelManager::instance();
 
-    m_codeModelFuture.cancel();
-    CppTools::ProjectInfo pInfo(this);
-    CppTools::ProjectPartBuilder ppBuilder(pInfo);
-
+    CodeModelInputs inputs;
     if (activeTarget()) {
-        CppTools::ProjectPart::QtVersion activeQtVersion = CppTools::ProjectPart::NoQt;
+        inputs.kitId = activeTarget()->kit()->id();
         if (QtSupport::BaseQtVersion *qtVersion =
                 QtSupport::QtKitInformation::qtVersion(activeTarget()->kit())) {
             if (qtVersion->qtVersion() < QtSupport::QtVersionNumber(5,0,0))
-                activeQtVersion = CppTools::ProjectPart::Qt4;
+                inputs.qtVersion = CppTools::ProjectPart::Qt4;
             else
-                activeQtVersion = CppTools::ProjectPart::Qt5;
+                inputs.qtVersion = CppTools::ProjectPart::Qt5;
         }
+    }
 
-        ppBuilder.setQtVersion(activeQtVersion);
+    foreach (const VsBuildTarget &target, buildTargets()) {
+        inputs.targets << target;
+        inputs.sourceFiles << m_vsProjectData->sourceFiles(target);
+        inputs.fileSettings << m_vsProjectData->fileSettings(target);
     }
 
+    // Skip the push if the code model already knows the same project parts
+    if (m_codeModelInputsValid && inputs == m_codeModelInputs && !m_codeModelFuture.isCanceled())
+        return;
+
+    m_codeModelInputs = inputs;
+    m_codeModelInputsValid = true;
+
+    m_codeModelFuture.cancel();
+    CppTools::ProjectInfo pInfo(this);
+    CppTools::ProjectPartBuilder ppBuilder(pInfo);
+
+    if (activeTarget())
+        ppBuilder.setQtVersion(inputs.qtVersion);
+
 //    QStringList cxxflags = m_makefileParserThread->data()->configurations()[0]->CxxFlags;
 //    ppBuilder.setCFlags(cxxflags);
 //    ppBuilder.setCxxFlags(cxxflags);
@@ -252,16 +405,46 @@ void VsProject::updateCppCodeModel()
 //    m_codeModelFuture = modelManager->updateProjectInfo(pInfo);
 
 
-    foreach (const VsBuildTarget &target, buildTargets()) {
-        ppBuilder.setIncludePaths(target.includeDirectories);
+    for (int t = 0; t < inputs.targets.size(); ++t) {
+        const VsBuildTarget &target = inputs.targets.at(t);
+        // Files with their own ClCompile metadata get a project part per distinct setting
+        const VsFileSettingsMap &fileSettings = inputs.fileSettings.at(t);
+        QStringList files;
+        QList<VsFileSettings> settingsGroups;
+        QList<QStringList> settingsFiles;
+        foreach (const QString &file, inputs.sourceFiles.at(t)) {
+            auto it = fileSettings.constFind(file);
+            if (it == fileSettings.cend()) {
+                files << file;
+                continue;
+            }
+
+            auto index = settingsGroups.indexOf(it.value());
+            if (index < 0) {
+                index = settingsGroups.size();
+                settingsGroups << it.value();
+                settingsFiles << QStringList();
+            }
+            settingsFiles[index] << file;
+        }
+
         ppBuilder.setCFlags(target.compilerOptions);
         ppBuilder.setCxxFlags(target.compilerOptions);
-        ppBuilder.setDefines(target.defines);
         ppBuilder.setDisplayName(target.title);
-
-        const QList<Core::Id> languages = ppBuilder.createProjectPartsForFiles(m_vsProjectData->files());
-        foreach (Core::Id language, languages)
-            setProjectLanguage(language, true);
+        for (auto i = -1; i < settingsGroups.size(); ++i) {
+            if (i < 0) {
+                ppBuilder.setIncludePaths(target.includeDirectories);
+                ppBuilder.setDefines(target.defines.toByteArray());
+            } else {
+                const VsFileSettings &settings = settingsGroups.at(i);
+                ppBuilder.setIncludePaths(settings.includeDirectories + target.includeDirectories);
+                ppBuilder.setDefines(VsDefineSet::fromDefines(target.defines.defines() + settings.defines.defines()).toByteArray());
+            }
+
+            const QList<Core::Id> languages = ppBuilder.createProjectPartsForFiles(i < 0 ? files : settingsFiles.at(i));
+            foreach (Core::Id language, languages)
+                setProjectLanguage(language, true);
+        }
     }
 
     m_codeModelFuture.cancel();
@@ -327,10 +510,7 @@ QList<VsBuildTarget> VsProject::buildTargets() const
     if (m_vsProjectData) {
         if (activeTarget() && activeTarget()->activeBuildConfiguration()) {
             auto bc = static_cast<VsBuildConfiguration *>(activeTarget()->activeBuildConfiguration());
-            result = Utils::filtered(m_vsProjectData->targets(),
-                                     [bc](const VsBuildTarget &ct) {
-                                         return bc->displayName() == ct.configuration;
-                                     });
+            result = m_vsProjectData->targets(bc->displayName());
         }
     }
 
@@ -398,27 +578,27 @@ static bool sortNodesByPath(ProjectExplorer::Node *a, ProjectExplorer::Node *b)
 void VsProject::buildTree()
 {
     auto rootNode = static_cast<VsProjectNode*>(rootProjectNode());
-    // clear root node
+    // clear root node, sub projects are folders too
     {
+        rootNode->removeProjectNodes(rootNode->subProjectNodes());
         auto fileNodes = rootNode->fileNodes();
         auto subFolderNodes = rootNode->subFolderNodes();
-        auto subProjectNodes = rootNode->subProjectNodes();
         rootNode->removeFileNodes(fileNodes);
         rootNode->removeFolderNodes(subFolderNodes);
-        rootNode->removeProjectNodes(subProjectNodes);
     }
 
     if (m_vsProjectData) {
-        buildTreeRec(rootNode, m_vsProjectData->rootFolder());
+        buildTreeRec(rootNode, m_vsProjectData.data(), m_vsProjectData->rootFolder());
     }
 }
 
-void VsProject::buildTreeRec(ProjectExplorer::FolderNode* parent, const VsProjectFolder* folder) const
+void VsProject::buildTreeRec(ProjectExplorer::FolderNode* parent, const VsProjectData* data, const VsProjectFolder* folder) const
 {
     QTC_ASSERT(parent, return;);
+    QTC_ASSERT(data, return;);
     QTC_ASSERT(folder, return;);
 
-    auto projectDirectory = Utils::FileName::fromString(m_vsProjectData->projectDirectory().absolutePath());
+    auto projectDirectory = Utils::FileName::fromString(data->projectDirectory().absolutePath());
     QList<ProjectExplorer::FileNode*> fileNodes;
     foreach (const QString& filePath, folder->Files) {
         fileNodes << new ProjectExplorer::FileNode(Utils::FileName::fromString(filePath), getFileType(filePath), false);
@@ -433,13 +613,19 @@ void VsProject::buildTreeRec(ProjectExplorer::FolderNode* parent, const VsProjec
         auto folderNode = new ProjectExplorer::VirtualFolderNode(projectDirectory, subFolderNames.size() - 1 - i);
         folderNode->setDisplayName(folderName);
         parent->addFolderNodes({ folderNode });
-        buildTreeRec(folderNode, folder->SubFolders.value(folderName));
+        buildTreeRec(folderNode, data, folder->SubFolders.value(folderName));
     }
 
+    // projects of a solution
     auto projectParent = parent->asProjectNode();
-    if (projectParent) {
-        // TODO
-
+    if (projectParent && folder == data->rootFolder()) {
+        foreach (const VsProjectData* subProject, data->subProjects()) {
+            auto projectNode = new VsProjectNode(subProject->projectFilePath());
+            projectNode->setDisplayName(subProject->projectFilePath().toFileInfo().completeBaseName());
+            projectNode->setIcon(Core::FileIconProvider::icon(subProject->projectFilePath().toFileInfo()));
+            projectParent->addProjectNodes({ projectNode });
+            buildTreeRec(projectNode, subProject, subProject->rootFolder());
+        }
     }
 }
 
@@ -28,10 +28,15 @@
 
 #include "vsprojectdata.h"
 
+#include <coreplugin/id.h>
+#include <cpptools/projectpart.h>
 #include <projectexplorer/project.h>
 #include <projectexplorer/projectnodes.h>
 
+#include <QElapsedTimer>
 #include <QFuture>
+#include <QFutureWatcher>
+#include <QTimer>
 
 QT_FORWARD_DECLARE_CLASS(QDir)
 
@@ -81,7 +86,12 @@ public:
     bool requiresTargetPanel() const override;
     bool knowsAllBuildExecutables() const override;
     bool supportsKit(ProjectExplorer::Kit *k, QString *errorMessage) const override;
-    VsProjectData* vsProjectData() const { return m_vsProjectData; }
+    VsProjectData* vsProjectData() const { return m_vsProjectData.data(); }
+
+    // File change events are coalesced into a single reload
+    void setReloadDelays(int quietPeriod, int maxDelay);
+    int fileChangeEventCount() const { return m_fileChangeEvents; }
+    int mergedFileChangeEventCount() const { return m_mergedFileChangeEvents; }
 
 protected:
     RestoreResult fromMap(const QVariantMap &map, QString *errorMessage) override;
@@ -92,27 +102,57 @@ private:
     void handleActiveBuildConfigurationChanged();
     static ProjectExplorer::FileType getFileType(const QString& fileName);
     void onTargetChanged();
+    void updateWatchedFiles();
     void updateApplicationAndDeploymentTargets();
     void updateTargetRunConfigurations(ProjectExplorer::Target *t);
 
     void loadProjectTree();
-    void parsingStarted();
     void parsingFinished();
     void onFileChanged(const QString &file);
+    void reloadTimeout();
     void updateCppCodeModel();
 
     void buildTree();
-    void buildTreeRec(ProjectExplorer::FolderNode* parent, const VsProjectFolder* folder) const;
+    void buildTreeRec(ProjectExplorer::FolderNode* parent, const VsProjectData* data, const VsProjectFolder* folder) const;
     void gatherFileNodes(ProjectExplorer::FolderNode *parent, QList<ProjectExplorer::FileNode *> &list) const;
 
 private:
     // Watches project files for changes.
     Utils::FileSystemWatcher *m_fileWatcher;
 
+    // Everything the code model is updated from, the update is skipped if it didn't change
+    struct CodeModelInputs
+    {
+        bool operator==(const CodeModelInputs &other) const;
+
+        Core::Id kitId;
+        CppTools::ProjectPart::QtVersion qtVersion = CppTools::ProjectPart::NoQt;
+        QList<VsBuildTarget> targets;
+        QList<QStringList> sourceFiles;        // by target
+        QList<VsFileSettingsMap> fileSettings; // by target
+    };
+
     QFuture<void> m_codeModelFuture;
+    CodeModelInputs m_codeModelInputs;
+    bool m_codeModelInputsValid = false;
+
+    // Project data is loaded on a worker thread
+    QFuture<VsProjectDataPtr> m_parseFuture;
+    QFutureWatcher<VsProjectDataPtr> m_parseFutureWatcher;
+    QStringList m_watchedFiles;
+    QStringList m_watchedDirectories;
+    QStringList m_changedFiles;
+
+    // Reload scheduling
+    QTimer m_reloadTimer;
+    QElapsedTimer m_firstPendingChange;
+    int m_reloadQuietPeriod;
+    int m_reloadMaxDelay;
+    int m_fileChangeEvents = 0;
+    int m_mergedFileChangeEvents = 0;
 
     ProjectExplorer::Target *m_connectedTarget = nullptr;
-    VsProjectData* m_vsProjectData = nullptr;
+    VsProjectDataPtr m_vsProjectData;
 };
 
 } // namespace Internal
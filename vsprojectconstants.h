@@ -40,5 +40,10 @@ namespace Constants {
 //Project
     const char PROJECT_ID[] = "VsProjectManager.VsProject";
     const char PROJECT_CONTEXT[] = "VsProjectManager.ProjectContext";
+    const char PARSE_TASK_ID[] = "VsProjectManager.ParseTask";
+
+//Reloading, in milliseconds
+    const int RELOAD_QUIET_PERIOD = 500;
+    const int RELOAD_MAX_DELAY = 3000;
 } // namespace Constants
 } // namespace VsProjectManager
@@ -25,8 +25,19 @@
 ****************************************************************************/
 
 #include "vsprojectdata.h"
-
+#include "vsxmltokenizer.h"
+#include "vsmacroexpander.h"
+#include "vspathnormalizer.h"
+#include "vspropertysheetcache.h"
+#include "vsstringpool.h"
+#include "vssolutiondata.h"
+#include "vswildcardexpander.h"
+
+#include <QDataStream>
 #include <QFile>
+#include <QXmlStreamReader>
+#include <QScopedPointer>
+#include <QtConcurrentRun>
 
 #include <algorithm>
 #include <stdio.h>
@@ -56,8 +67,21 @@ const QString _SolutionDir(QStringLiteral("$(SolutionDir)"));
 const QString _TargetExt(QStringLiteral("$(TargetExt)"));
 const QString _TargetName(QStringLiteral("$(TargetName)"));
 const QString Debug(QStringLiteral("Debug"));
+const QString Exclude(QStringLiteral("Exclude"));
 const QString Filter(QStringLiteral("Filter"));
 const QString Include(QStringLiteral("Include"));
+const QString ItemGroup(QStringLiteral("ItemGroup"));
+const QString PropertyGroup(QStringLiteral("PropertyGroup"));
+const QString ItemDefinitionGroup(QStringLiteral("ItemDefinitionGroup"));
+const QString Import(QStringLiteral("Import"));
+const QString ImportGroup(QStringLiteral("ImportGroup"));
+const QString Project(QStringLiteral("Project"));
+const QString ProjectReference(QStringLiteral("ProjectReference"));
+const QString Condition(QStringLiteral("Condition"));
+const QString ExcludedFromBuild(QStringLiteral("ExcludedFromBuild"));
+const QString PreprocessorDefinitions(QStringLiteral("PreprocessorDefinitions"));
+const QString AdditionalIncludeDirectories(QStringLiteral("AdditionalIncludeDirectories"));
+const QString Label(QStringLiteral("Label"));
 const QString Release(QStringLiteral("Release"));
 const QString Win32(QStringLiteral("Win32"));
 const QString x64(QStringLiteral("x64"));
@@ -132,7 +156,8 @@ HWND findMainWindow(DWORD processId)
     return data.bestHandle;
 }
 
-bool IsKnownNodeName(const QString& name)
+template <typename String>
+bool IsKnownNodeName(const String& name)
 {
     return
             /* VS2010 */
@@ -150,6 +175,115 @@ bool IsKnownNodeName(const QString& name)
             false;
 }
 
+// Collects the text of the child elements of a property group or an item definition.
+QHash<QString, QString> readProperties(const QDomElement& element)
+{
+    QHash<QString, QString> properties;
+    for (auto child = element.firstChildElement(); !child.isNull(); child = child.nextSiblingElement()) {
+        properties.insert(child.nodeName(), child.text());
+    }
+    return properties;
+}
+
+template <typename Reader>
+QHash<QString, QString> readStreamProperties(Reader& reader)
+{
+    QHash<QString, QString> properties;
+    while (reader.readNextStartElement()) {
+        auto name = reader.name().toString();
+        properties.insert(name, reader.readElementText(QXmlStreamReader::SkipChildElements));
+    }
+    return properties;
+}
+
+void writeFolder(QDataStream& stream, const VsProjectFolder& folder)
+{
+    stream << folder.Files << static_cast<qint32>(folder.SubFolders.size());
+    for (auto it = folder.SubFolders.cbegin(); it != folder.SubFolders.cend(); ++it) {
+        stream << it.key();
+        writeFolder(stream, *it.value());
+    }
+}
+
+void internFolder(VsProjectFolder& folder)
+{
+    VsStringPool::intern(folder.Files);
+    for (auto subFolder : folder.SubFolders) {
+        internFolder(*subFolder);
+    }
+}
+
+void readFolder(QDataStream& stream, VsProjectFolder& folder)
+{
+    qint32 count = 0;
+    stream >> folder.Files >> count;
+    for (qint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString name;
+        stream >> name;
+        auto subFolder = new VsProjectFolder();
+        folder.SubFolders.insert(name, subFolder);
+        readFolder(stream, *subFolder);
+    }
+}
+
+// Stops reading once the configurations have been seen, they come first in
+// both project formats
+template <typename Reader>
+QStringList scanConfigurationNames(Reader& reader)
+{
+    QStringList configurations;
+    if (!reader.readNextStartElement()) {
+        return configurations;
+    }
+
+    const auto isVs2005 = reader.name() == QLatin1String("VisualStudioProject");
+    if (!isVs2005 && reader.name() != QLatin1String("Project")) {
+        return configurations;
+    }
+
+    while (reader.readNextStartElement()) {
+        if (isVs2005 && reader.name() == QLatin1String("Configurations")) {
+            while (reader.readNextStartElement()) {
+                if (reader.name() == QLatin1String("Configuration")) {
+                    configurations << reader.attributes().value(QLatin1String("Name")).toString();
+                }
+                reader.skipCurrentElement();
+            }
+            break;
+        }
+
+        if (!isVs2005 && reader.name() == ItemGroup && reader.attributes().value(Label) == QLatin1String("ProjectConfigurations")) {
+            while (reader.readNextStartElement()) {
+                if (reader.name() == QLatin1String("ProjectConfiguration")) {
+                    configurations << reader.attributes().value(Include).toString();
+                }
+                reader.skipCurrentElement();
+            }
+            break;
+        }
+
+        reader.skipCurrentElement();
+    }
+
+    return configurations;
+}
+
+template <typename Source>
+VsProjectData* createVs2010ProjectData(const Utils::FileName& projectFilePath, const QString& version, Source& source, const QString& solutionDirectory)
+{
+    if (version == QLatin1String("4.0")) { // VS2010
+        return new Vs2010ProjectData(projectFilePath, source, solutionDirectory, "VS100COMNTOOLS", 1600);
+    } else if (version == QLatin1String("11.0")) { // VS2012
+        return new Vs2010ProjectData(projectFilePath, source, solutionDirectory, "VS110COMNTOOLS", 1700);
+    } else if (version == QLatin1String("12.0")) { // VS2013
+        return new Vs2010ProjectData(projectFilePath, source, solutionDirectory, "VS120COMNTOOLS", 1800);
+    } else if (version == QLatin1String("14.0")) { // VS2015
+        return new Vs2010ProjectData(projectFilePath, source, solutionDirectory, "VS140COMNTOOLS", 1900);
+    }
+
+    return nullptr;
+}
+
 } // namespace
 
 
@@ -165,6 +299,43 @@ VsProjectFolder::~VsProjectFolder()
 }
 
 
+QDataStream& operator<<(QDataStream& stream, const VsBuildTarget& target)
+{
+    return stream << target.configuration
+                  << target.title
+                  << target.output
+                  << target.outdir
+                  << target.projectFile
+                  << static_cast<qint32>(target.targetType)
+                  << target.includeDirectories
+                  << target.compilerOptions
+                  << target.defines;
+}
+
+QDataStream& operator>>(QDataStream& stream, VsBuildTarget& target)
+{
+    qint32 targetType = TT_Other;
+    stream >> target.configuration
+           >> target.title
+           >> target.output
+           >> target.outdir
+           >> target.projectFile
+           >> targetType
+           >> target.includeDirectories
+           >> target.compilerOptions
+           >> target.defines;
+    target.targetType = static_cast<TargetType>(targetType);
+    return stream;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void VsProjectFolder::swap(VsProjectFolder& other)
+{
+    Files.swap(other.Files);
+    SubFolders.swap(other.SubFolders);
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////
 VsProjectData::~VsProjectData()
 {
@@ -172,24 +343,81 @@ VsProjectData::~VsProjectData()
     releaseDevenvProcess();
 }
 
-VsProjectData::VsProjectData(const Utils::FileName& projectFilePath, const QDomDocument& doc) :
-    m_doc(doc),
+VsProjectData::VsProjectData(const Utils::FileName& projectFilePath, const QString& solutionDirectory) :
     m_projectFilePath(projectFilePath),
-    m_projectDirectory(projectFilePath.toFileInfo().absoluteDir())
+    m_projectDirectory(projectFilePath.toFileInfo().absoluteDir()),
+    m_solutionDirectory(resolveSolutionDirectory(projectFilePath, solutionDirectory))
 { }
 
-VsProjectData* VsProjectData::load(const Utils::FileName& projectFilePath)
+QString VsProjectData::resolveSolutionDirectory(const Utils::FileName& projectFilePath, const QString& solutionDirectory)
+{
+    return QDir::cleanPath(solutionDirectory.isEmpty() ? projectFilePath.toFileInfo().absolutePath() : solutionDirectory);
+}
+
+VsProjectData::ParserType VsProjectData::defaultParser()
+{
+    // Allows to benchmark the parsers against each other
+    static const ParserType parser = [] {
+        const auto name = qgetenv("QTC_VSPROJECTMANAGER_PARSER");
+        if (name == "dom") {
+            return DomParser;
+        } else if (name == "stream") {
+            return StreamParser;
+        }
+        return TokenizerParser;
+    }();
+    return parser;
+}
+
+VsProjectData* VsProjectData::load(const Utils::FileName& projectFilePath, const QString& solutionDirectory, ParserType parser)
 {
     QFileInfo info(projectFilePath.toFileInfo());
+    if (info.suffix().compare(QLatin1String("sln"), Qt::CaseInsensitive) == 0) {
+        return new VsSolutionData(projectFilePath);
+    }
+
+    if (parser == TokenizerParser) {
+        VsXmlTokenizer tokenizer(info.absoluteFilePath());
+        if (tokenizer.isOpen()) {
+            if (tokenizer.readNextStartElement() && tokenizer.name() == QLatin1String("Project")) {
+                auto version = tokenizer.attributes().value(QLatin1String("ToolsVersion")).toString().replace(QLatin1Char(','), QLatin1Char('.'));
+                return createVs2010ProjectData(projectFilePath, version, tokenizer, solutionDirectory);
+            }
+
+            // VS2005 projects are evaluated on the DOM, the tokenizer already decoded the file
+            QDomDocument doc;
+            doc.setContent(tokenizer.document());
+            return createFromDocument(projectFilePath, doc, solutionDirectory);
+        } else {
+            qWarning("%s: %s", qPrintable(info.absoluteFilePath()), qPrintable(tokenizer.errorString()));
+            parser = StreamParser;
+        }
+    }
+
     QFile file(info.absoluteFilePath());
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    if (!file.open(QIODevice::ReadOnly)) {
         qWarning("%s: %s", qPrintable(info.absoluteFilePath()), qPrintable(file.errorString()));
         return nullptr;
     }
 
+    if (parser == StreamParser) {
+        QXmlStreamReader reader(&file);
+        if (reader.readNextStartElement() && reader.name() == QLatin1String("Project")) {
+            auto version = reader.attributes().value(QLatin1String("ToolsVersion")).toString().replace(QLatin1Char(','), QLatin1Char('.'));
+            return createVs2010ProjectData(projectFilePath, version, reader, solutionDirectory);
+        }
+
+        // VS2005 projects are evaluated on the DOM
+        file.seek(0);
+    }
+
     QDomDocument doc;
     doc.setContent(&file);
+    return createFromDocument(projectFilePath, doc, solutionDirectory);
+}
 
+VsProjectData* VsProjectData::createFromDocument(const Utils::FileName& projectFilePath, const QDomDocument& doc, const QString& solutionDirectory)
+{
 #ifdef VSDEBUG
     FILE* f = fopen("c:\\temp\\proj.xml", "w");
     if (f) {
@@ -202,7 +430,7 @@ VsProjectData* VsProjectData::load(const Utils::FileName& projectFilePath)
     if (root.nodeName() == QLatin1String("VisualStudioProject")) {
         auto version = root.attributes().namedItem(QLatin1String("Version")).nodeValue().replace(QLatin1Char(','), QLatin1Char('.'));
         if (version == QLatin1String("8.00")) {
-            return new Vs2005ProjectData(projectFilePath, doc);
+            return new Vs2005ProjectData(projectFilePath, doc, solutionDirectory);
         } else {
             qWarning("Don't know how to parse version %s project files", qPrintable(version));
             return nullptr;
@@ -211,22 +439,105 @@ VsProjectData* VsProjectData::load(const Utils::FileName& projectFilePath)
 
     if (root.nodeName() == QLatin1String("Project")) {
         auto version = root.attributes().namedItem(QLatin1String("ToolsVersion")).nodeValue().replace(QLatin1Char(','), QLatin1Char('.'));
-        if (version == QLatin1String("4.0")) { // VS2010
-            return new Vs2010ProjectData(projectFilePath, doc, "VS100COMNTOOLS", 1600);
-        } else if (version == QLatin1String("11.0")) { // VS2012
-            return new Vs2010ProjectData(projectFilePath, doc, "VS110COMNTOOLS", 1700);
-        } else if (version == QLatin1String("12.0")) { // VS2013
-            return new Vs2010ProjectData(projectFilePath, doc, "VS120COMNTOOLS", 1800);
-        } else if (version == QLatin1String("14.0")) { // VS2015
-            return new Vs2010ProjectData(projectFilePath, doc, "VS140COMNTOOLS", 1900);
-        } else {
-            return nullptr;
+        return createVs2010ProjectData(projectFilePath, version, doc, solutionDirectory);
+    }
+
+    return nullptr;
+}
+
+QStringList VsProjectData::scanConfigurations(const Utils::FileName& projectFilePath)
+{
+    QFileInfo info(projectFilePath.toFileInfo());
+    if (info.suffix().compare(QLatin1String("sln"), Qt::CaseInsensitive) == 0) {
+        return VsSolutionData::scanConfigurations(projectFilePath);
+    }
+
+    if (defaultParser() == TokenizerParser) {
+        VsXmlTokenizer tokenizer(info.absoluteFilePath());
+        if (tokenizer.isOpen()) {
+            return scanConfigurationNames(tokenizer);
         }
     }
 
+    QFile file(info.absoluteFilePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning("%s: %s", qPrintable(info.absoluteFilePath()), qPrintable(file.errorString()));
+        return QStringList();
+    }
+
+    QXmlStreamReader reader(&file);
+    return scanConfigurationNames(reader);
+}
+
+VsProjectData* VsProjectData::restore(const Utils::FileName& projectFilePath, QDataStream& stream)
+{
+    quint8 modelType = 0;
+    stream >> modelType;
+    switch (modelType) {
+    case Vs2005Model:
+        return new Vs2005ProjectData(projectFilePath, stream);
+    case Vs2010Model:
+        return new Vs2010ProjectData(projectFilePath, stream);
+    case SolutionModel:
+        return new VsSolutionData(projectFilePath, stream);
+    }
+
+    return nullptr;
+}
+
+VsProjectData* VsProjectData::reload(const VsProjectData& previous, const QStringList& changedFiles)
+{
+    ModelParts parts;
+    for (const auto& changedFile : changedFiles)
+        parts |= previous.dependentParts(changedFile);
+
+    if (parts && !(parts & TargetsPart)) {
+        if (auto data = previous.recompute(parts))
+            return data;
+    }
+
+    return load(previous.projectFilePath(), previous.solutionDirectory());
+}
+
+VsProjectData::ModelParts VsProjectData::dependentParts(const QString& filePath) const
+{
+    Q_UNUSED(filePath);
+    return AllParts;
+}
+
+VsProjectData* VsProjectData::recompute(ModelParts parts) const
+{
+    Q_UNUSED(parts);
     return nullptr;
 }
 
+void VsProjectData::saveFolders(QDataStream& stream) const
+{
+    writeFolder(stream, m_rootFolder);
+}
+
+void VsProjectData::restoreFolders(QDataStream& stream)
+{
+    readFolder(stream, m_rootFolder);
+    internFolders();
+}
+
+void VsProjectData::internTarget(VsBuildTarget& target)
+{
+    target.configuration = VsStringPool::intern(target.configuration);
+    target.title = VsStringPool::intern(target.title);
+    target.output = VsStringPool::intern(target.output);
+    target.outdir = VsStringPool::intern(target.outdir);
+    target.projectFile = VsStringPool::intern(target.projectFile);
+    VsStringPool::intern(target.includeDirectories);
+    VsStringPool::intern(target.compilerOptions);
+}
+
+void VsProjectData::internFolders()
+{
+    internFolder(m_rootFolder);
+}
+
 void VsProjectData::splitConfiguration(const QString& configuration, QString* configurationName, QString* platformName)
 {
     QString platform = Win32;
@@ -243,34 +554,12 @@ void VsProjectData::splitConfiguration(const QString& configuration, QString* co
 
 QString VsProjectData::makeAbsoluteFilePath(const QString& input) const
 {
-    auto output = QDir::fromNativeSeparators(input);
-    if (QDir::isRelativePath(output)) {
-        output = QDir::cleanPath(projectDirectory().absoluteFilePath(output));
-    }
-    return output;
+    return makeAbsoluteFilePath(projectDirectory(), input);
 }
 
-QString VsProjectData::substitute(QString input, const VariableSubstitution& sub)
+QString VsProjectData::makeAbsoluteFilePath(const QDir& directory, const QString& input)
 {
-    VariableSubstitution::const_iterator beg = sub.begin();
-    VariableSubstitution::const_iterator end = sub.end();
-    QString output;
-
-    while (1) {
-        output = input;
-
-        for (VariableSubstitution::const_iterator it = beg; it != end; ++it) {
-            output = output.replace(it.key(), it.value());
-        }
-
-        if (output == input) {
-            break;
-        }
-
-        input = output;
-    }
-
-    return output;
+    return VsPathNormalizer::absoluteFilePath(directory.absolutePath(), input);
 }
 
 void VsProjectData::addDefaultIncludeDirectories(QStringList& includes) const
@@ -280,37 +569,37 @@ void VsProjectData::addDefaultIncludeDirectories(QStringList& includes) const
 }
 
 void VsProjectData::addDefaultDefines(
-        QByteArray& defines,
+        VsDefineSet::Builder& defines,
         const QString& platform,
         RuntimeLibraryType rt) const
 {
-    defines += "#define _WIN32\n";
+    defines.add("_WIN32");
     if (Win32 == platform) {
-        defines += "#define _M_IX86\n";
+        defines.add("_M_IX86");
     }
 
     if (x64 == platform) {
-        defines += "#define _M_X64\n";
-        defines += "#define _M_AMD64\n"; // not true for VS2005
-        defines += "#define _WIN64\n";
+        defines.add("_M_X64");
+        defines.add("_M_AMD64"); // not true for VS2005
+        defines.add("_WIN64");
     }
 
     switch (rt) {
     case RTL_MT:
-        defines += "#define _MT\n";
+        defines.add("_MT");
         break;
     case RTL_MTd:
-        defines += "#define _MT\n";
-        defines += "#define _DEBUG\n";
+        defines.add("_MT");
+        defines.add("_DEBUG");
         break;
     case RTL_MD:
-        defines += "#define _MT\n";
-        defines += "#define _DLL\n";
+        defines.add("_MT");
+        defines.add("_DLL");
         break;
     case RTL_MDd:
-        defines += "#define _MT\n";
-        defines += "#define _DLL\n";
-        defines += "#define _DEBUG\n";
+        defines.add("_MT");
+        defines.add("_DLL");
+        defines.add("_DEBUG");
         break;
     }
 }
@@ -365,6 +654,109 @@ QStringList VsProjectData::files() const
     return files;
 }
 
+QStringList VsProjectData::files(const QString& configuration) const
+{
+    Q_UNUSED(configuration);
+    return files();
+}
+
+QStringList VsProjectData::sourceFiles(const VsBuildTarget& target) const
+{
+    return files(target.configuration);
+}
+
+VsFileSettingsMap VsProjectData::fileSettings(const VsBuildTarget& target) const
+{
+    Q_UNUSED(target);
+    return VsFileSettingsMap();
+}
+
+VsBuildTargets VsProjectData::targets(const QString& configuration) const
+{
+    VsBuildTargets result;
+    foreach (const VsBuildTarget& target, targets()) {
+        if (target.configuration == configuration) {
+            result << target;
+        }
+    }
+    return result;
+}
+
+VsBuildTarget VsProjectData::evaluateTarget(int configurationIndex) const
+{
+    Q_UNUSED(configurationIndex);
+    return VsBuildTarget();
+}
+
+VsBuildTarget VsProjectData::materializedTarget(int configurationIndex) const
+{
+    QMutexLocker locker(&m_materializeMutex);
+    auto it = m_materializedTargets.constFind(configurationIndex);
+    if (it == m_materializedTargets.constEnd()) {
+        it = m_materializedTargets.insert(configurationIndex, evaluateTarget(configurationIndex));
+    }
+    return it.value();
+}
+
+VsBuildTargets VsProjectData::materializedTargets() const
+{
+    VsBuildTargets result;
+    const auto count = configurations().size();
+    result.reserve(count);
+    for (auto i = 0; i < count; ++i) {
+        result << materializedTarget(i);
+    }
+    return result;
+}
+
+VsBuildTargets VsProjectData::materializedTargets(const QString& configuration) const
+{
+    auto index = configurations().indexOf(configuration);
+    if (index < 0) {
+        return VsBuildTargets();
+    }
+
+    return VsBuildTargets() << materializedTarget(index);
+}
+
+// Only valid if other evaluates the configurations the same way
+void VsProjectData::adoptMaterializedTargets(const VsProjectData& other)
+{
+    QMutexLocker locker(&other.m_materializeMutex);
+    m_materializedTargets = other.m_materializedTargets;
+}
+
+void VsProjectData::buildInSolutionCmd(const QString& configuration, const Utils::FileName& solutionFile, QString* cmd, QString* args) const
+{
+    Q_UNUSED(solutionFile);
+    buildCmd(configuration, cmd, args);
+}
+
+QStringList VsProjectData::projectReferences() const
+{
+    return QStringList();
+}
+
+QStringList VsProjectData::directoriesToWatch() const
+{
+    return QStringList();
+}
+
+QList<VsProjectData*> VsProjectData::subProjects() const
+{
+    QList<VsProjectData*> projects;
+    projects.reserve(m_subProjects.size());
+    for (const auto& project : m_subProjects) {
+        projects << project.data();
+    }
+    return projects;
+}
+
+void VsProjectData::addSubProject(const VsProjectDataPtr& project)
+{
+    m_subProjects << project;
+}
+
 void VsProjectData::collectFiles(QStringList& files, const VsProjectFolder& folder)
 {
     files << folder.Files;
@@ -374,238 +766,317 @@ void VsProjectData::collectFiles(QStringList& files, const VsProjectFolder& fold
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-Vs2005ProjectData::Vs2005ProjectData(const Utils::FileName& projectFile, const QDomDocument& doc)
-    : VsProjectData(projectFile, doc)
+Vs2005ProjectData::Vs2005ProjectData(const Utils::FileName& projectFile, const QDomDocument& doc, const QString& solutionDirectory)
+    : VsProjectData(projectFile, solutionDirectory)
 {
-    auto toolsPath = qgetenv("VS80COMNTOOLS");
-    auto installDir = QDir(QString::fromLocal8Bit(toolsPath));
-    installDir.cdUp();
-    installDir.cdUp();
-    setInstallDir(installDir);
-
-    m_vcvarsPath  = QDir::toNativeSeparators(installDir.absoluteFilePath(QLatin1String("VC/vcvarsall.bat")));
-    m_solutionDir = projectDirectory().path();
-    m_filesToWatch << projectFile.toFileInfo().absoluteFilePath();
+    init();
 
+    // Targets are evaluated on demand from the recorded attributes, see evaluateTarget()
     auto configurationNodes = doc.documentElement().namedItem(QLatin1String("Configurations")).childNodes();
-    m_targets.reserve(configurationNodes.size());
-
     for (auto i = 0; i < configurationNodes.count(); ++i) {
         const auto& configNode = configurationNodes.at(i);
-        auto key = configNode.attributes().namedItem(QLatin1String("Name")).nodeValue();
-
-        m_configurations << key;
-        QString platform, configuration;
-        splitConfiguration(key, &configuration, &platform);
-
-        VariableSubstitution sub;
-        sub.insert(_ConfigurationName, configuration);
-        sub.insert(_PlatformName, platform);
-        sub.insert(_ProjectDir, projectDirectory().path() + QLatin1String("/"));
-        sub.insert(_SolutionDir, m_solutionDir  + QLatin1String("/"));
-        sub.insert(_ProjectName, projectFile.toFileInfo().baseName());
-        sub.insert(_OutDir, getDefaultOutputDirectory(platform));
-        sub.insert(_IntDir, getDefaultIntDirectory(platform));
-
-
-        VsBuildTarget target;
-        target.configuration = key;
-        target.title = projectFile.toFileInfo().baseName();
-        target.output = _OutDir + _ProjectName + _TargetExt;
-        target.outdir = configNode.attributes().namedItem(QLatin1String("OutputDirectory")).nodeValue();
-        target.defines += "#define _MSC_VER=1400\n";
-
-        auto configurationType = configNode.attributes().namedItem(QLatin1String("ConfigurationType")).nodeValue().toInt();
-        switch (configurationType) {
-        case 1:
-            target.targetType = TT_ExecutableType;
-            sub.insert(_TargetExt, QLatin1String(".exe"));
-            break;
-        case 2:
-            target.targetType = TT_DynamicLibraryType;
-            sub.insert(_TargetExt, QLatin1String(".dll"));
-            break;
-        case 3:
-            target.targetType = TT_StaticLibraryType;
-            sub.insert(_TargetExt, QLatin1String(".lib"));
-            break;
-        case 4:
-            target.targetType = TT_UtilityType;
-            break;
-        default:
-            target.targetType = TT_Other;
-            break;
+        if (!configNode.isElement()) {
+            continue;
         }
 
-
-        auto charset = configNode.attributes().namedItem(QLatin1String("CharacterSet")).nodeValue().toInt();
-        switch (charset) {
-        case 1:
-            target.defines += "#define _UNICODE\n#define UNICODE\n";
-            break;
-        case 2:
-            target.defines += "#define _MBCS\n";
-            break;
+        VariableSubstitution attributes;
+        auto configAttributes = configNode.attributes();
+        for (auto j = 0; j < configAttributes.count(); ++j) {
+            auto attribute = configAttributes.item(j).toAttr();
+            attributes.insert(attribute.name(), attribute.value());
         }
 
-        auto useOfMfc = configNode.attributes().namedItem(QLatin1String("UseOfMFC")).nodeValue().toInt();
-        if (useOfMfc == 2) { // shared DLL
-            target.defines += "#define _AFXDLL\n";
+        for (auto tool = configNode.firstChildElement(QLatin1String("Tool")); !tool.isNull(); tool = tool.nextSiblingElement(QLatin1String("Tool"))) {
+            auto prefix = tool.attribute(QLatin1String("Name")) + QLatin1Char('/');
+            attributes.insert(prefix, QString());
+            auto toolAttributes = tool.attributes();
+            for (auto j = 0; j < toolAttributes.count(); ++j) {
+                auto attribute = toolAttributes.item(j).toAttr();
+                attributes.insert(prefix + attribute.name(), attribute.value());
+            }
         }
 
-        // parse project type (executable), include dirs, defines, c(xx)flags
-        auto configNodeChildren = configNode.childNodes();
-        for (auto j = 0; j < configNodeChildren.count(); ++j) {
-            const auto& configChildNode = configNodeChildren.at(j);
-            if (configChildNode.nodeType() == QDomNode::ElementNode &&
-                configChildNode.nodeName() == QLatin1String("Tool")) {
-
-                const auto& toolNode = configChildNode;
-                auto toolName = configChildNode.attributes().namedItem(QLatin1String("Name")).nodeValue();
-                if (toolName == QLatin1String("VCCLCompilerTool")) {
-                    auto additionalIncludeDirs = configChildNode.attributes().namedItem(QLatin1String("AdditionalIncludeDirectories")).nodeValue();
-                    auto additionalIncludeDirsList = additionalIncludeDirs.splitRef(QLatin1Char(';'), QString::SkipEmptyParts);
-                    if (additionalIncludeDirsList.size() == 1) {
-                        additionalIncludeDirsList = additionalIncludeDirs.splitRef(QLatin1Char(','), QString::SkipEmptyParts);
-                    }
-
-                    target.includeDirectories.reserve(additionalIncludeDirsList.size());
-                    foreach (const QStringRef& ref, additionalIncludeDirsList) {
-                        target.includeDirectories << makeAbsoluteFilePath(ref.toString());
-                    }
-
-                    // default includes
-                    addDefaultIncludeDirectories(target.includeDirectories);
-                    target.includeDirectories.append(installDir.absolutePath() + QLatin1String("/VC/PlatformSDK/include"));
-
-                    auto defines = configChildNode.attributes().namedItem(QLatin1String("PreprocessorDefinitions")).nodeValue().split(QLatin1Char(';'));
-                    foreach (const QString& define, defines) {
-                        target.defines.append("#define ");
-                        target.defines.append(define.toLocal8Bit().replace('=', ' '));
-                        target.defines += '\n';
-                    }
+        m_configurations << attributes.value(QLatin1String("Name"));
+        m_configurationAttributes << attributes;
+    }
 
-                    auto runtimeLibrary = configChildNode.attributes().namedItem(QLatin1String("RuntimeLibrary")).nodeValue().toInt();
-                    auto rtl = RuntimeLibraryType::RTL_Other;
-                    switch (runtimeLibrary) {
-                    case 0:
-                        target.compilerOptions += QLatin1String("/MT");
-                        rtl = RTL_MT;
-                        break;
-                    case 1:
-                        target.compilerOptions += QLatin1String("/MTd");
-                        rtl = RTL_MTd;
-                        break;
-                    case 2:
-                        target.compilerOptions += QLatin1String("/MD");
-                        rtl = RTL_MD;
-                        break;
-                    case 3:
-                        target.compilerOptions += QLatin1String("/MDd");
-                        rtl = RTL_MDd;
-                        break;
-                    }
+    // parse <Files> section once, exclusions are recorded per configuration
+    auto filesChildNodes = doc.documentElement().namedItem(QLatin1String("Files")).childNodes();
+    parseFilter(filesChildNodes, *rootFolder());
+    internFolders();
+}
 
-                    addDefaultDefines(target.defines, platform, rtl);
+Vs2005ProjectData::Vs2005ProjectData(const Utils::FileName& projectFile, QDataStream& stream)
+    : VsProjectData(projectFile)
+{
+    init();
 
-                } else if (toolName == QLatin1String("VCLinkerTool")) {
-                    switch (target.targetType) {
-                    case TT_DynamicLibraryType:
-                    case TT_ExecutableType: {
-                            QString outfile = toolNode.attributes().namedItem(QLatin1String("OutputFile")).nodeValue();
-                            if (!outfile.isEmpty()) {
-                                target.output = outfile;
-                            }
-                        }
-                        break;
-                    }
-                } else if (toolName == QLatin1String("VCLibrarianTool")) {
-                    if (TT_StaticLibraryType == target.targetType) {
-                        QString outfile = toolNode.attributes().namedItem(QLatin1String("OutputFile")).nodeValue();
-                        if (!outfile.isEmpty()) {
-                            target.output = outfile;
-                        }
-                    }
-                }
-            }
-        }
+    QString solutionDirectory;
+    stream >> solutionDirectory >> m_configurations >> m_configurationAttributes >> m_filesToWatch >> m_excludedFiles;
+    setSolutionDirectory(solutionDirectory);
+    restoreFolders(stream);
+}
 
-        // parse <Files> section in the context of this configuration
-        auto filesChildNodes = doc.documentElement().namedItem(QLatin1String("Files")).childNodes();
-        parseFilter(filesChildNodes, key, *rootFolder());
+void Vs2005ProjectData::init()
+{
+    auto toolsPath = qgetenv("VS80COMNTOOLS");
+    auto installDir = QDir(QString::fromLocal8Bit(toolsPath));
+    installDir.cdUp();
+    installDir.cdUp();
+    setInstallDir(installDir);
 
-        target.outdir = substitute(target.outdir, sub);
-        target.outdir = makeAbsoluteFilePath(target.outdir);
-        target.output = substitute(target.output, sub);
-        target.output = makeAbsoluteFilePath(target.output);
+    m_vcvarsPath  = QDir::toNativeSeparators(installDir.absoluteFilePath(QLatin1String("VC/vcvarsall.bat")));
+    m_filesToWatch << projectFilePath().toFileInfo().absoluteFilePath();
+}
 
-        m_targets << target;
-    }
+void Vs2005ProjectData::save(QDataStream& stream) const
+{
+    stream << static_cast<quint8>(Vs2005Model) << solutionDirectory() << m_configurations << m_configurationAttributes << m_filesToWatch << m_excludedFiles;
+    saveFolders(stream);
 }
 
-void Vs2005ProjectData::parseFilter(
-        const QDomNodeList& xmlItems,
-        const QString& configuration,
-        VsProjectFolder& parentFolder) const
+void Vs2005ProjectData::parseFilter(const QDomNodeList& xmlItems, VsProjectFolder& parentFolder)
 {
-    QFileInfo fi;
     for (auto i = 0; i < xmlItems.count(); ++i) {
         const auto& node = xmlItems.at(i);
         if (node.nodeType() == QDomNode::ElementNode) {
             if (node.nodeName() == QLatin1String("File")) {
 
                 auto relPath = node.attributes().namedItem(QLatin1String("RelativePath")).nodeValue();
-                fi.setFile(projectDirectory(), relPath);
+                auto filePath = makeAbsoluteFilePath(relPath);
 
-                auto include = true;
+                QBitArray excluded;
                 auto fileNodeChildren = node.childNodes();
                 for (auto j = 0; j < fileNodeChildren.count(); ++j) {
                     auto fileNodeChild = fileNodeChildren.at(j);
-                    if (node.nodeType() == QDomNode::ElementNode &&
+                    if (fileNodeChild.nodeType() == QDomNode::ElementNode &&
                         fileNodeChild.nodeName() == QLatin1String("FileConfiguration")) {
-                        include = fileNodeChild.attributes().namedItem(QLatin1String("Name")).nodeValue() == configuration;
-                        if (include) {
-                            break;
+                        auto attributes = fileNodeChild.attributes();
+                        auto excludedFromBuild = attributes.namedItem(QLatin1String("ExcludedFromBuild")).nodeValue();
+                        if (excludedFromBuild.compare(QLatin1String("true"), Qt::CaseInsensitive) == 0) {
+                            auto index = m_configurations.indexOf(attributes.namedItem(QLatin1String("Name")).nodeValue());
+                            if (index >= 0) {
+                                excluded.resize(m_configurations.size());
+                                excluded.setBit(index);
+                            }
                         }
                     }
                 }
 
-                if (include) {
-                    parentFolder.Files << QDir::cleanPath(fi.absoluteFilePath());
+                parentFolder.Files << filePath;
+                if (!excluded.isEmpty()) {
+                    m_excludedFiles.insert(filePath, excluded);
                 }
             } else {
                  if (node.nodeName() == QLatin1String("Filter")) {
                      auto filterName = node.attributes().namedItem(QLatin1String("Name")).nodeValue();
-                     VsProjectFolder* filterFolder = new VsProjectFolder();
-                     parentFolder.SubFolders.insert(filterName, filterFolder);
-                     parseFilter(node.childNodes(), configuration, *filterFolder);
+                     // filters may be listed more than once, merge their contents
+                     auto& filterFolder = parentFolder.SubFolders[filterName];
+                     if (!filterFolder) {
+                         filterFolder = new VsProjectFolder();
+                     }
+                     parseFilter(node.childNodes(), *filterFolder);
                  }
             }
         }
     }
 }
 
-VsBuildTargets Vs2005ProjectData::targets() const
+QStringList Vs2005ProjectData::files(const QString& configuration) const
 {
-    return m_targets;
+    auto index = m_configurations.indexOf(configuration);
+    if (index < 0 || m_excludedFiles.isEmpty()) {
+        return files();
+    }
+
+    QStringList result;
+    collectBuildFiles(result, *rootFolder(), m_excludedFiles, index);
+    return result;
 }
 
-QStringList Vs2005ProjectData::filesToWatch() const
+void VsProjectData::collectBuildFiles(QStringList& files, const VsProjectFolder& folder, const QHash<QString, QBitArray>& excludedFiles, int configurationIndex)
 {
-    return m_filesToWatch;
+    for (const auto& file : folder.Files) {
+        auto it = excludedFiles.constFind(file);
+        if (it == excludedFiles.cend() || !it->testBit(configurationIndex)) {
+            files << file;
+        }
+    }
+
+    for (auto subFolder : folder.SubFolders) {
+        collectBuildFiles(files, *subFolder, excludedFiles, configurationIndex);
+    }
 }
 
-void Vs2005ProjectData::buildCmd(const QString& configuration, QString* cmd, QString* args) const
+VsBuildTargets Vs2005ProjectData::targets() const
 {
-    makeCmd(configuration, QString(), *cmd, *args);
+    return materializedTargets();
 }
 
-void Vs2005ProjectData::cleanCmd(const QString& configuration, QString* cmd, QString* args) const
+VsBuildTargets Vs2005ProjectData::targets(const QString& configuration) const
 {
-    makeCmd(configuration, QLatin1String("/Clean "), *cmd, *args);
+    return materializedTargets(configuration);
 }
 
-void Vs2005ProjectData::makeCmd(const QString& configuration, const QString& buildSwitch, QString& cmd, QString& args) const
+VsBuildTarget Vs2005ProjectData::evaluateTarget(int configurationIndex) const
+{
+    const auto& key = m_configurations.at(configurationIndex);
+    const auto& attributes = m_configurationAttributes.at(configurationIndex);
+
+    QString platform, configuration;
+    splitConfiguration(key, &configuration, &platform);
+
+    VariableSubstitution sub;
+    sub.insert(_ConfigurationName, configuration);
+    sub.insert(_PlatformName, platform);
+    sub.insert(_ProjectDir, projectDirectory().path() + QLatin1String("/"));
+    sub.insert(_SolutionDir, solutionDirectory() + QLatin1String("/"));
+    sub.insert(_ProjectName, projectFilePath().toFileInfo().baseName());
+    sub.insert(_OutDir, getDefaultOutputDirectory(platform));
+    sub.insert(_IntDir, getDefaultIntDirectory(platform));
+
+
+    VsBuildTarget target;
+    VsDefineSet::Builder defines;
+    target.configuration = key;
+    target.projectFile = projectFilePath().toString();
+    target.title = projectFilePath().toFileInfo().baseName();
+    target.output = _OutDir + _ProjectName + _TargetExt;
+    target.outdir = attributes.value(QLatin1String("OutputDirectory"));
+    defines.add("_MSC_VER", "1400");
+
+    auto configurationType = attributes.value(QLatin1String("ConfigurationType")).toInt();
+    switch (configurationType) {
+    case 1:
+        target.targetType = TT_ExecutableType;
+        sub.insert(_TargetExt, QLatin1String(".exe"));
+        break;
+    case 2:
+        target.targetType = TT_DynamicLibraryType;
+        sub.insert(_TargetExt, QLatin1String(".dll"));
+        break;
+    case 3:
+        target.targetType = TT_StaticLibraryType;
+        sub.insert(_TargetExt, QLatin1String(".lib"));
+        break;
+    case 4:
+        target.targetType = TT_UtilityType;
+        break;
+    default:
+        target.targetType = TT_Other;
+        break;
+    }
+
+
+    auto charset = attributes.value(QLatin1String("CharacterSet")).toInt();
+    switch (charset) {
+    case 1:
+        defines.add("_UNICODE");
+        defines.add("UNICODE");
+        break;
+    case 2:
+        defines.add("_MBCS");
+        break;
+    }
+
+    auto useOfMfc = attributes.value(QLatin1String("UseOfMFC")).toInt();
+    if (useOfMfc == 2) { // shared DLL
+        defines.add("_AFXDLL");
+    }
+
+    // include dirs, defines, c(xx)flags
+    if (attributes.contains(QLatin1String("VCCLCompilerTool/"))) {
+        auto additionalIncludeDirs = attributes.value(QLatin1String("VCCLCompilerTool/AdditionalIncludeDirectories"));
+        auto additionalIncludeDirsList = additionalIncludeDirs.splitRef(QLatin1Char(';'), QString::SkipEmptyParts);
+        if (additionalIncludeDirsList.size() == 1) {
+            additionalIncludeDirsList = additionalIncludeDirs.splitRef(QLatin1Char(','), QString::SkipEmptyParts);
+        }
+
+        target.includeDirectories.reserve(additionalIncludeDirsList.size());
+        foreach (const QStringRef& ref, additionalIncludeDirsList) {
+            target.includeDirectories << makeAbsoluteFilePath(ref.toString());
+        }
+
+        // default includes
+        addDefaultIncludeDirectories(target.includeDirectories);
+        target.includeDirectories.append(installDir().absolutePath() + QLatin1String("/VC/PlatformSDK/include"));
+
+        auto definitions = attributes.value(QLatin1String("VCCLCompilerTool/PreprocessorDefinitions")).split(QLatin1Char(';'), QString::SkipEmptyParts);
+        foreach (const QString& definition, definitions) {
+            defines.addDefinition(definition);
+        }
+
+        auto runtimeLibrary = attributes.value(QLatin1String("VCCLCompilerTool/RuntimeLibrary")).toInt();
+        auto rtl = RuntimeLibraryType::RTL_Other;
+        switch (runtimeLibrary) {
+        case 0:
+            target.compilerOptions += QLatin1String("/MT");
+            rtl = RTL_MT;
+            break;
+        case 1:
+            target.compilerOptions += QLatin1String("/MTd");
+            rtl = RTL_MTd;
+            break;
+        case 2:
+            target.compilerOptions += QLatin1String("/MD");
+            rtl = RTL_MD;
+            break;
+        case 3:
+            target.compilerOptions += QLatin1String("/MDd");
+            rtl = RTL_MDd;
+            break;
+        }
+
+        addDefaultDefines(defines, platform, rtl);
+    }
+
+    switch (target.targetType) {
+    case TT_DynamicLibraryType:
+    case TT_ExecutableType: {
+            auto outfile = attributes.value(QLatin1String("VCLinkerTool/OutputFile"));
+            if (!outfile.isEmpty()) {
+                target.output = outfile;
+            }
+        }
+        break;
+    case TT_StaticLibraryType: {
+            auto outfile = attributes.value(QLatin1String("VCLibrarianTool/OutputFile"));
+            if (!outfile.isEmpty()) {
+                target.output = outfile;
+            }
+        }
+        break;
+    default:
+        break;
+    }
+
+    VsMacroExpander expander(sub);
+    target.outdir = expander.expand(target.outdir);
+    target.outdir = makeAbsoluteFilePath(target.outdir);
+    target.output = expander.expand(target.output);
+    target.output = makeAbsoluteFilePath(target.output);
+
+    target.defines = defines.build();
+    internTarget(target);
+    return target;
+}
+
+QStringList Vs2005ProjectData::filesToWatch() const
+{
+    return m_filesToWatch;
+}
+
+void Vs2005ProjectData::buildCmd(const QString& configuration, QString* cmd, QString* args) const
+{
+    makeCmd(configuration, QString(), *cmd, *args);
+}
+
+void Vs2005ProjectData::cleanCmd(const QString& configuration, QString* cmd, QString* args) const
+{
+    makeCmd(configuration, QLatin1String("/Clean "), *cmd, *args);
+}
+
+void Vs2005ProjectData::makeCmd(const QString& configuration, const QString& buildSwitch, QString& cmd, QString& args) const
 {
     auto cfgArg = configuration;
     cfgArg.replace(QLatin1String("|"), QLatin1String("^|"));
@@ -656,10 +1127,147 @@ QString Vs2005ProjectData::getDefaultIntDirectory(const QString& platform)
 Vs2010ProjectData::Vs2010ProjectData(
         const Utils::FileName& projectFile,
         const QDomDocument& doc,
+        const QString& solutionDirectory,
         const char* toolsEnvVarName,
         unsigned mscVer)
-    : VsProjectData(projectFile, doc)
+    : VsProjectData(projectFile, solutionDirectory)
 {
+    init(toolsEnvVarName, mscVer);
+    auto filters = readFiltersAsync(DomParser);
+    m_itemFiles = evaluate(doc);
+    mergeFilters(filters);
+}
+
+Vs2010ProjectData::Vs2010ProjectData(
+        const Utils::FileName& projectFile,
+        QXmlStreamReader& reader,
+        const QString& solutionDirectory,
+        const char* toolsEnvVarName,
+        unsigned mscVer)
+    : VsProjectData(projectFile, solutionDirectory)
+{
+    init(toolsEnvVarName, mscVer);
+    auto filters = readFiltersAsync(StreamParser);
+    m_itemFiles = evaluateStream(reader);
+    mergeFilters(filters);
+}
+
+Vs2010ProjectData::Vs2010ProjectData(
+        const Utils::FileName& projectFile,
+        VsXmlTokenizer& tokenizer,
+        const QString& solutionDirectory,
+        const char* toolsEnvVarName,
+        unsigned mscVer)
+    : VsProjectData(projectFile, solutionDirectory)
+{
+    init(toolsEnvVarName, mscVer);
+    auto filters = readFiltersAsync(TokenizerParser);
+    m_itemFiles = evaluateStream(tokenizer);
+    mergeFilters(filters);
+}
+
+Vs2010ProjectData::Vs2010ProjectData(const Utils::FileName& projectFile, QDataStream& stream)
+    : VsProjectData(projectFile)
+{
+    QByteArray toolsEnvVarName;
+    quint32 mscVer = 0;
+    QString solutionDirectory;
+    stream >> toolsEnvVarName >> mscVer >> solutionDirectory;
+    setSolutionDirectory(solutionDirectory);
+    init(toolsEnvVarName.constData(), mscVer);
+
+    qint32 operationCount = 0;
+    stream >> m_configurations >> operationCount;
+    for (qint32 i = 0; i < operationCount && stream.status() == QDataStream::Ok; ++i) {
+        qint32 type = 0;
+        Operation operation;
+        stream >> type
+               >> operation.condition
+               >> operation.outerCondition
+               >> operation.name
+               >> operation.value
+               >> operation.properties
+               >> operation.link;
+        operation.type = static_cast<Operation::Type>(type);
+        m_operations << operation;
+    }
+    qint32 itemMetadataCount = 0;
+    stream >> itemMetadataCount;
+    for (qint32 i = 0; i < itemMetadataCount && stream.status() == QDataStream::Ok; ++i) {
+        ItemMetadata item;
+        stream >> item.filePath >> item.name >> item.value >> item.condition;
+        m_itemMetadata << item;
+    }
+    stream >> m_itemFiles >> m_projectReferences >> m_directoriesToWatch >> m_filesToWatch;
+    restoreFolders(stream);
+
+    VsStringPool::intern(m_itemFiles);
+}
+
+// Shares the evaluated project file with previous and only reads the filters again
+Vs2010ProjectData::Vs2010ProjectData(const Vs2010ProjectData& previous, ParserType parser)
+    : VsProjectData(previous.projectFilePath(), previous.solutionDirectory())
+{
+    init(previous.m_toolsEnvVarName.constData(), previous.m_mscVer);
+
+    m_configurations = previous.m_configurations;
+    m_operations = previous.m_operations;
+    m_itemFiles = previous.m_itemFiles;
+    m_projectReferences = previous.m_projectReferences;
+    m_directoriesToWatch = previous.m_directoriesToWatch;
+    m_itemMetadata = previous.m_itemMetadata;
+    // the .filters file is added back if it still exists
+    m_filesToWatch = previous.m_filesToWatch;
+    m_filesToWatch.removeAll(filtersFilePath());
+    // targets first, sheets imported meanwhile are at worst watched needlessly
+    adoptMaterializedTargets(previous);
+    {
+        QMutexLocker locker(previous.materializeMutex());
+        m_importedFiles = previous.m_importedFiles;
+        m_itemSettings = previous.m_itemSettings;
+        m_conditions = previous.m_conditions;
+    }
+
+    mergeFilters(readFiltersAsync(parser));
+    setRecomputedParts(FoldersPart);
+}
+
+void Vs2010ProjectData::save(QDataStream& stream) const
+{
+    stream << static_cast<quint8>(Vs2010Model)
+           << m_toolsEnvVarName
+           << static_cast<quint32>(m_mscVer)
+           << solutionDirectory()
+           << m_configurations
+           << static_cast<qint32>(m_operations.size());
+    for (const auto& operation : m_operations) {
+        stream << static_cast<qint32>(operation.type)
+               << operation.condition
+               << operation.outerCondition
+               << operation.name
+               << operation.value
+               << operation.properties
+               << operation.link;
+    }
+    stream << static_cast<qint32>(m_itemMetadata.size());
+    for (const auto& item : m_itemMetadata) {
+        stream << item.filePath
+               << item.name
+               << item.value
+               << item.condition;
+    }
+    stream << m_itemFiles
+           << m_projectReferences
+           << m_directoriesToWatch
+           << m_filesToWatch;
+    saveFolders(stream);
+}
+
+void Vs2010ProjectData::init(const char* toolsEnvVarName, unsigned mscVer)
+{
+    m_toolsEnvVarName = toolsEnvVarName;
+    m_mscVer = mscVer;
+
     auto toolsPath = qgetenv(toolsEnvVarName);
     auto installDir = QDir(QString::fromLocal8Bit(toolsPath));
     installDir.cdUp();
@@ -667,13 +1275,11 @@ Vs2010ProjectData::Vs2010ProjectData(
     setInstallDir(installDir);
 
     m_vcvarsPath  = QDir::toNativeSeparators(installDir.absoluteFilePath(QLatin1String("VC/vcvarsall.bat")));
-    m_solutionDir = projectDirectory().path();
-    m_filesToWatch << projectFile.toFileInfo().absoluteFilePath();
-
-    // _MSC_VER
-    char mscVerDefine[32];
-    _snprintf_s(mscVerDefine, _countof(mscVerDefine), _TRUNCATE, "#define _MSC_VER=%u\n", mscVer);
+    m_filesToWatch << projectFilePath().toFileInfo().absoluteFilePath();
+}
 
+QStringList Vs2010ProjectData::evaluate(const QDomDocument& doc)
+{
     QStringList files;
 
     auto childNodes = doc.documentElement().childNodes();
@@ -682,9 +1288,9 @@ Vs2010ProjectData::Vs2010ProjectData(
         auto childNode = childNodes.at(i);
         if (childNode.nodeType() == QDomNode::ElementNode) {
             QDomElement element = childNode.toElement();
-            if (element.nodeName() == QLatin1String("ItemGroup")) {
+            if (element.nodeName() == ItemGroup) {
                 if (element.hasAttributes()) {
-                    if (element.attribute(QLatin1String("Label")) == QLatin1String("ProjectConfigurations")) {
+                    if (element.attribute(Label) == QLatin1String("ProjectConfigurations")) {
                         auto projectConfigurationNodes = element.childNodes();
                         for (auto i = 0; i < projectConfigurationNodes.count(); ++i) {
                             auto childNode = projectConfigurationNodes.at(i);
@@ -700,7 +1306,13 @@ Vs2010ProjectData::Vs2010ProjectData(
                             auto element = childNode.toElement();
                             auto name = element.nodeName();
                             if (IsKnownNodeName(name)) {
-                                files << makeAbsoluteFilePath(element.attribute(Include));
+                                auto itemPaths = itemFiles(element.attribute(Include), element.attribute(Exclude));
+                                files << itemPaths;
+                                for (auto child = element.firstChildElement(); !child.isNull(); child = child.nextSiblingElement()) {
+                                    addItemMetadata(itemPaths, child.nodeName(), child.text(), child.attribute(Condition));
+                                }
+                            } else if (name == ProjectReference) {
+                                m_projectReferences << makeAbsoluteFilePath(element.attribute(Include));
                             }
                         }
                     }
@@ -709,254 +1321,699 @@ Vs2010ProjectData::Vs2010ProjectData(
         }
     }
 
-    // 2nd pass to pick up targets
-    foreach (const QString& configuration, m_configurations) {
-        QString platformName, configurationName;
-        splitConfiguration(configuration, &configurationName, &platformName);
+    // 2nd pass to record the groups the targets are evaluated from
+    for (auto i = 0; i < childNodes.count(); ++i) {
+        auto childNode = childNodes.at(i);
+        if (childNode.nodeType() == QDomNode::ElementNode) {
+            QDomElement element = childNode.toElement();
+            QString elementName = element.nodeName();
+            if (elementName == PropertyGroup) {
+                auto condition = element.attribute(Condition);
+                if (element.attribute(Label) == QLatin1String("Configuration")) {
+                    addOperation(Operation::ConfigurationProperties, condition);
+                    m_operations.last().properties = readProperties(element);
+                } else {
+                    for (auto child = element.firstChildElement(); !child.isNull(); child = child.nextSiblingElement()) {
+                        addOperation(Operation::SetProperty, child.attribute(Condition), condition);
+                        m_operations.last().name = child.nodeName();
+                        m_operations.last().value = child.text();
+                    }
+                }
+            } else if (elementName == ItemDefinitionGroup) {
+                addOperation(Operation::ItemDefinitions, element.attribute(Condition));
+                m_operations.last().properties = readProperties(element.namedItem(QLatin1String("ClCompile")).toElement());
+                m_operations.last().link = readProperties(element.namedItem(QLatin1String("Link")).toElement());
+            } else if (elementName == Import) {
+                addOperation(Operation::Import, element.attribute(Condition));
+                m_operations.last().name = element.attribute(Project);
+            } else if (elementName == ImportGroup) {
+                auto condition = element.attribute(Condition);
+                for (auto child = element.firstChildElement(Import); !child.isNull(); child = child.nextSiblingElement(Import)) {
+                    addOperation(Operation::Import, child.attribute(Condition), condition);
+                    m_operations.last().name = child.attribute(Project);
+                }
+            }
+        }
+    }
 
-        VariableSubstitution sub;
-        sub.insert(_Configuration, configurationName);
-        sub.insert(_ConfigurationName, configurationName);
-        sub.insert(_Platform, platformName);
-        sub.insert(_PlatformName, platformName);
-        sub.insert(_ProjectDir, projectDirectory().path() + QLatin1String("/"));
-        sub.insert(_SolutionDir, m_solutionDir  + QLatin1String("/"));
-        sub.insert(_ProjectName, projectFile.toFileInfo().baseName());
-        sub.insert(_TargetName, _ProjectName);
-        sub.insert(_OutDir, getDefaultOutputDirectory(platformName));
-        sub.insert(_IntDir, getDefaultIntDirectory(platformName));
+    return files;
+}
 
+template <typename Reader>
+QStringList Vs2010ProjectData::evaluateStream(Reader& reader)
+{
+    // The reader is positioned on the <Project> element. The groups are recorded
+    // in document order, targets are evaluated from them on demand.
+    QStringList files;
 
-        VsBuildTarget target;
-        target.targetType = TT_Other;
-        target.configuration = configuration;
-        target.title = projectFile.toFileInfo().baseName();
-        target.outdir = _OutDir;
-        target.output = _OutDir + _TargetName + _TargetExt;
-        target.defines += mscVerDefine;
-
-        auto condition = QStringLiteral("'$(Configuration)|$(Platform)'=='%1'").arg(configuration);
-
-        for (auto i = 0; i < childNodes.count(); ++i) {
-            auto childNode = childNodes.at(i);
-            if (childNode.nodeType() == QDomNode::ElementNode) {
-                QDomElement element = childNode.toElement();
-                QString elementName = element.nodeName();
-                if (elementName == QLatin1String("PropertyGroup")) {
-                    if (element.hasAttributes()) {
-                        if (element.attribute(QLatin1String("Condition")) == condition) {
-                            if (element.hasAttributes()) {
-                                if (element.attribute(QLatin1String("Label")) == QLatin1String("Configuration")) {
-                                    QString configurationType = element.namedItem(QLatin1String("ConfigurationType")).childNodes().at(0).nodeValue();
-                                    if (configurationType == QLatin1String("Application")) {
-                                        target.targetType = TT_ExecutableType;
-                                        sub.insert(_TargetExt, QLatin1String(".exe"));
-                                    } else if (configurationType == QLatin1String("DynamicLibrary")) {
-                                        target.targetType = TT_DynamicLibraryType;
-                                        sub.insert(_TargetExt, QLatin1String(".dll"));
-                                    } else if (configurationType == QLatin1String("StaticLibrary")) {
-                                        target.targetType = TT_StaticLibraryType;
-                                        sub.insert(_TargetExt, QLatin1String(".lib"));
-                                    } else if (configurationType == QLatin1String("Utility")) {
-                                        target.targetType = TT_UtilityType;
-                                    } else {
-                                        target.targetType = TT_Other;
-                                    }
-
-                                    auto charsetNode = element.namedItem(QLatin1String("CharacterSet"));
-                                    if (charsetNode.isElement()) {
-                                        auto charset = charsetNode.childNodes().at(0).nodeValue();
-                                        if (charset == QLatin1String("Unicode")) {
-                                            target.defines += "#define _UNICODE\n#define UNICODE\n";
-                                        } else if (charset == QLatin1String("MultiByte")) {
-                                            target.defines += "#define _MBCS\n";
-                                        }
-                                    }
-
-                                    auto useOfMfcNode = element.namedItem(QLatin1String("UseOfMfc"));
-                                    if (useOfMfcNode.isElement()) {
-                                        auto useOfMfc = useOfMfcNode.childNodes().at(0).nodeValue();
-                                        if (useOfMfc == QLatin1String("Dynamic")) {
-                                            target.defines += "#define _AFXDLL\n";
-                                        }
-                                    }
-                                }
-                            }
+    while (reader.readNextStartElement()) {
+        if (reader.name() == ItemGroup) {
+            if (reader.attributes().value(Label) == QLatin1String("ProjectConfigurations")) {
+                while (reader.readNextStartElement()) {
+                    if (reader.name() == QLatin1String("ProjectConfiguration")) {
+                        auto configuration = reader.attributes().value(Include).toString();
+                        m_configurations << configuration;
+                    }
+                    reader.skipCurrentElement();
+                }
+            } else if (reader.attributes().isEmpty()) {
+                while (reader.readNextStartElement()) {
+                    if (IsKnownNodeName(reader.name())) {
+                        auto itemPaths = itemFiles(reader.attributes().value(Include).toString(), reader.attributes().value(Exclude).toString());
+                        files << itemPaths;
+                        while (reader.readNextStartElement()) {
+                            auto name = reader.name().toString();
+                            auto condition = reader.attributes().value(Condition).toString();
+                            auto value = reader.readElementText(QXmlStreamReader::SkipChildElements);
+                            addItemMetadata(itemPaths, name, value, condition);
                         }
-                    } else { // no attributes
-                        auto propertyGroupChildNodes = element.childNodes();
-                        for (auto i = 0; i < propertyGroupChildNodes.count(); ++i) {
-                            auto childNode = propertyGroupChildNodes.at(i);
-                            if (childNode.nodeType() == QDomNode::ElementNode) {
-                                QDomElement element = childNode.toElement();
-                                if (element.nodeName() == QLatin1String("TargetName")) {
-                                    if (element.attribute(QLatin1String("Condition")) == condition) {
-                                        sub[_TargetName] = element.childNodes().at(0).nodeValue();
-                                    }
-                                } else if (element.nodeName() == QLatin1String("OutDir")) {
-                                    if (element.attribute(QLatin1String("Condition")) == condition) {
-                                        sub[_OutDir] = QDir::fromNativeSeparators(element.childNodes().at(0).nodeValue());
-                                    }
-                                } else if (element.nodeName() == QLatin1String("IntDir")) {
-                                    if (element.attribute(QLatin1String("Condition")) == condition) {
-                                        sub[_IntDir] = QDir::fromNativeSeparators(element.childNodes().at(0).nodeValue());
-                                    }
-                                }
-                            }
+                    } else {
+                        if (reader.name() == ProjectReference) {
+                            m_projectReferences << makeAbsoluteFilePath(reader.attributes().value(Include).toString());
                         }
+                        reader.skipCurrentElement();
                     }
-                } else if (elementName == QLatin1String("ItemDefinitionGroup")) {
-                    if (element.attribute(QLatin1String("Condition")) == condition) {
-                        QDomElement compileElement = element.namedItem(QLatin1String("ClCompile")).toElement();
-                        auto defines = compileElement.namedItem(QLatin1String("PreprocessorDefinitions")).childNodes().at(0).nodeValue().split(QLatin1Char(';'));
-                        foreach (const QString define, defines) {
-                            if (define == QLatin1String("%(PreprocessorDefinitions)")) {
-                                continue;
-                            }
+                }
+            } else {
+                reader.skipCurrentElement();
+            }
+        } else if (reader.name() == PropertyGroup) {
+            auto condition = reader.attributes().value(Condition).toString();
+            if (reader.attributes().value(Label) == QLatin1String("Configuration")) {
+                addOperation(Operation::ConfigurationProperties, condition);
+                m_operations.last().properties = readStreamProperties(reader);
+            } else {
+                while (reader.readNextStartElement()) {
+                    addOperation(Operation::SetProperty, reader.attributes().value(Condition).toString(), condition);
+                    m_operations.last().name = reader.name().toString();
+                    m_operations.last().value = reader.readElementText(QXmlStreamReader::SkipChildElements);
+                }
+            }
+        } else if (reader.name() == ItemDefinitionGroup) {
+            addOperation(Operation::ItemDefinitions, reader.attributes().value(Condition).toString());
+            while (reader.readNextStartElement()) {
+                if (reader.name() == QLatin1String("ClCompile")) {
+                    m_operations.last().properties = readStreamProperties(reader);
+                } else if (reader.name() == QLatin1String("Link")) {
+                    m_operations.last().link = readStreamProperties(reader);
+                } else {
+                    reader.skipCurrentElement();
+                }
+            }
+        } else if (reader.name() == Import) {
+            addOperation(Operation::Import, reader.attributes().value(Condition).toString());
+            m_operations.last().name = reader.attributes().value(Project).toString();
+            reader.skipCurrentElement();
+        } else if (reader.name() == ImportGroup) {
+            auto condition = reader.attributes().value(Condition).toString();
+            while (reader.readNextStartElement()) {
+                if (reader.name() == Import) {
+                    addOperation(Operation::Import, reader.attributes().value(Condition).toString(), condition);
+                    m_operations.last().name = reader.attributes().value(Project).toString();
+                }
+                reader.skipCurrentElement();
+            }
+        } else {
+            reader.skipCurrentElement();
+        }
+    }
 
-                            target.defines += "#define ";
-                            target.defines += define.toLocal8Bit();
-                            target.defines += '\n';
-                        }
+    if (reader.hasError()) {
+        qWarning("%s: %s", qPrintable(projectFilePath().toString()), qPrintable(reader.errorString()));
+    }
 
-                        auto includes = compileElement.namedItem(QLatin1String("AdditionalIncludeDirectories")).childNodes().at(0).nodeValue().split(QLatin1Char(';'));
-                        foreach (const QString include, includes) {
-                            if (include == QLatin1String("%(AdditionalIncludeDirectories)")) {
-                                continue;
-                            }
+    return files;
+}
 
-                            target.includeDirectories << makeAbsoluteFilePath(include);
-                        }
+VsProjectData::ModelParts Vs2010ProjectData::dependentParts(const QString& filePath) const
+{
+    if (QFileInfo(filePath).absoluteFilePath() == filtersFilePath())
+        return FoldersPart;
 
-                        auto runtimeLibraryNode = compileElement.namedItem(QLatin1String("RuntimeLibrary"));
-                        auto rtl = RTL_Other;
-                        if (runtimeLibraryNode.isElement()) {
-                            auto runtimeLibrary = runtimeLibraryNode.childNodes().at(0).nodeValue();
-                            if (QLatin1String("MultiThreadedDLL") == runtimeLibrary) {
-                                target.compilerOptions << QLatin1String("/MD");
-                                rtl = RTL_MD;
-                            } else if (QLatin1String("MultiThreadedDebugDLL") == runtimeLibrary) {
-                                target.compilerOptions << QLatin1String("/MDd");
-                                rtl = RTL_MDd;
-                            } else if (QLatin1String("MultiThreaded") == runtimeLibrary) {
-                                target.compilerOptions << QLatin1String("/MT");
-                                rtl = RTL_MT;
-                            } else if (QLatin1String("MultiThreadedDebug") == runtimeLibrary) {
-                                target.compilerOptions << QLatin1String("/MTd");
-                                rtl = RTL_MTd;
-                            }
-                        } else { // omitted, assume defaults derived from configuration names
-                            if (configurationName == Debug) {
-                                target.compilerOptions << QLatin1String("/MDd");
-                                rtl = RTL_MDd;
-                            } else if (configurationName == Release) {
-                                target.compilerOptions << QLatin1String("/MD");
-                                rtl = RTL_MD;
+    return AllParts;
+}
+
+VsProjectData* Vs2010ProjectData::recompute(ModelParts parts) const
+{
+    if (parts & TargetsPart)
+        return nullptr;
+
+    return new Vs2010ProjectData(*this, defaultParser());
+}
+
+QString Vs2010ProjectData::filtersFilePath() const
+{
+    return projectFilePath().toFileInfo().absoluteFilePath() + QStringLiteral(".filters");
+}
+
+QFuture<VsProjectFolder*> Vs2010ProjectData::readFiltersAsync(ParserType parser)
+{
+    QFileInfo filterFileInfo(filtersFilePath());
+    if (!filterFileInfo.exists()) {
+        return QFuture<VsProjectFolder*>();
+    }
+
+    m_filesToWatch << filterFileInfo.absoluteFilePath();
+
+    // The .filters file doesn't depend on the project file, read it while the project is evaluated
+    return QtConcurrent::run(&Vs2010ProjectData::readFilters, filterFileInfo.absoluteFilePath(), projectDirectory().absolutePath(), parser);
+}
+
+void Vs2010ProjectData::mergeFilters(QFuture<VsProjectFolder*> filters)
+{
+    VsStringPool::intern(m_itemFiles);
+
+    // A default constructed future reports as canceled, there is no .filters file
+    if (filters.isCanceled()) {
+        return;
+    }
+
+    QScopedPointer<VsProjectFolder> folder(filters.result());
+    if (folder) {
+        rootFolder()->swap(*folder);
+        internFolders();
+    } else {
+        // backup plan, all files in root dir
+        rootFolder()->Files << m_itemFiles;
+    }
+}
+
+// Builds the project folder hierarchy, called on a worker thread.
+VsProjectFolder* Vs2010ProjectData::readFilters(const QString& filePath, const QString& projectDirectoryPath, ParserType parser)
+{
+    const QDir projectDirectory(projectDirectoryPath);
+    QScopedPointer<VsProjectFolder> root(new VsProjectFolder());
+
+    if (parser == TokenizerParser) {
+        VsXmlTokenizer tokenizer(filePath);
+        if (tokenizer.isOpen()) {
+            readFilterItems(tokenizer, *root, projectDirectory);
+            return root.take();
+        }
+
+        qWarning("%s: %s", qPrintable(filePath), qPrintable(tokenizer.errorString()));
+        parser = StreamParser;
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning("%s: %s", qPrintable(filePath), qPrintable(file.errorString()));
+        return nullptr;
+    }
+
+    if (parser == StreamParser) {
+        QXmlStreamReader reader(&file);
+        readFilterItems(reader, *root, projectDirectory);
+        return root.take();
+    }
+
+    QDomDocument doc;
+    doc.setContent(&file);
+
+    auto childNodes = doc.documentElement().childNodes();
+    for (auto i = 0; i < childNodes.count(); ++i) {
+        auto childNode = childNodes.at(i);
+        if (childNode.nodeType() == QDomNode::ElementNode) {
+            QDomElement element = childNode.toElement();
+            if (element.nodeName() == ItemGroup) {
+                auto itemGroupChildNodes = element.childNodes();
+                for (auto i = 0; i < itemGroupChildNodes.count(); ++i) {
+                    auto childNode = itemGroupChildNodes.at(i);
+                    if (childNode.nodeType() == QDomNode::ElementNode) {
+                        QDomElement element = childNode.toElement();
+                        if (IsKnownNodeName(element.nodeName())) {
+                            auto filterElement = element.namedItem(Filter).toElement();
+                            if (filterElement.isElement()) {
+                                addToFilter(*root, projectDirectory, element.attribute(Include), element.attribute(Exclude), filterElement.text());
                             }
                         }
+                    }
+                }
+            }
+        }
+    }
 
-                        addDefaultDefines(target.defines, platformName, rtl);
+    return root.take();
+}
+
+template <typename Reader>
+void Vs2010ProjectData::readFilterItems(Reader& reader, VsProjectFolder& root, const QDir& projectDirectory)
+{
+    if (!reader.readNextStartElement()) { // <Project>
+        return;
+    }
 
-                        QDomElement linkElement = element.namedItem(QLatin1String("Link")).toElement();
-                        auto outputFileNode = linkElement.namedItem(QLatin1String("OutputFile"));
-                        if (outputFileNode.isElement()) {
-                            target.output = QDir::fromNativeSeparators(outputFileNode.childNodes().at(0).nodeValue());
+    while (reader.readNextStartElement()) {
+        if (reader.name() == ItemGroup) {
+            while (reader.readNextStartElement()) {
+                if (IsKnownNodeName(reader.name())) {
+                    auto include = reader.attributes().value(Include).toString();
+                    auto exclude = reader.attributes().value(Exclude).toString();
+                    while (reader.readNextStartElement()) {
+                        if (reader.name() == Filter) {
+                            addToFilter(root, projectDirectory, include, exclude, reader.readElementText(QXmlStreamReader::SkipChildElements));
+                        } else {
+                            reader.skipCurrentElement();
                         }
                     }
+                } else {
+                    reader.skipCurrentElement();
                 }
             }
+        } else {
+            reader.skipCurrentElement();
         }
+    }
+}
 
-        addDefaultIncludeDirectories(target.includeDirectories);
+void Vs2010ProjectData::addToFilter(
+        VsProjectFolder& root,
+        const QDir& projectDirectory,
+        const QString& include,
+        const QString& exclude,
+        const QString& filterName)
+{
+    VsProjectFolder* parent = &root;
+    foreach (const QString& pathComponent, filterName.split(QLatin1Char('\\'), QString::SkipEmptyParts)) {
+        auto it = parent->SubFolders.find(pathComponent);
+        if (it == parent->SubFolders.end()) {
+            it = parent->SubFolders.insert(pathComponent, new VsProjectFolder());
+        }
 
-        target.outdir = substitute(target.outdir, sub);
-        target.outdir = makeAbsoluteFilePath(target.outdir);
-        target.output = substitute(target.output, sub);
-        target.output = makeAbsoluteFilePath(target.output);
+        parent = it.value();
+    }
 
-        m_targets << target;
+    // The project file evaluates the same wildcards, its directories are watched already
+    if (VsWildcardExpander::hasWildcards(include)) {
+        parent->Files << VsWildcardExpander::expand(projectDirectory.absolutePath(), include, exclude);
+    } else {
+        parent->Files << makeAbsoluteFilePath(projectDirectory, include);
     }
+}
 
-//    std::sort(files.begin(), files.end());
-//    m_files.erase(std::unique(files.begin(), files.end()), files.end());
+// Conditions see the properties as they are at this point of the evaluation. Each one
+// is compiled once per project, its results are shared by all configurations.
+bool Vs2010ProjectData::matches(const TargetState& state, const QString& condition, const QString& outerCondition) const
+{
+    auto outerConditionId = m_conditions.compile(outerCondition);
+    if (!m_conditions.evaluate(outerConditionId, state.sub)) {
+        return false;
+    }
 
-    // build project folder hierarchy
-    QFileInfo filterFileInfo(projectDirectory().filePath(projectFile.toFileInfo().fileName() + QStringLiteral(".filters")));
-    if (filterFileInfo.exists()) {
-        m_filesToWatch << filterFileInfo.absoluteFilePath();
+    return m_conditions.evaluate(m_conditions.compile(condition), state.sub);
+}
 
-        QFile file(filterFileInfo.absoluteFilePath());
-        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            qWarning("%s: %s", qPrintable(filterFileInfo.absoluteFilePath()), qPrintable(file.errorString()));
-            // backup plan, all files in root dir
-            rootFolder()->Files << files;
-        } else {
-            QDomDocument doc;
-            doc.setContent(&file);
-
-//            QHash<QString, void*> filterNames;
-
-            childNodes = doc.documentElement().childNodes();
-            // first pass to pick up files and configurations
-            for (auto i = 0; i < childNodes.count(); ++i) {
-                auto childNode = childNodes.at(i);
-                if (childNode.nodeType() == QDomNode::ElementNode) {
-                    QDomElement element = childNode.toElement();
-                    if (element.nodeName() == QLatin1String("ItemGroup")) {
-                        auto itemGroupChildNodes = element.childNodes();
-                        for (auto i = 0; i < itemGroupChildNodes.count(); ++i) {
-                            auto childNode = itemGroupChildNodes.at(i);
-                            if (childNode.nodeType() == QDomNode::ElementNode) {
-                                QDomElement element = childNode.toElement();
-                                auto name = element.nodeName();
-                                /*if (name == QLatin1String("Filter")) {
-                                    // build folder structure
-                                    auto filterName = element.attributes().namedItem(QLatin1Literal("Include")).nodeValue();
-                                    VsProjectFolder* parent = rootFolder();
-                                    foreach (const QString& pathComponent, filterName.split(QLatin1Char('\\'), QString::SkipEmptyParts)) {
-                                        auto it = parent->SubFolders.find(pathComponent);
-                                        if (it == parent->SubFolders.end()) {
-                                            it = parent->SubFolders.insert(pathComponent, new VsProjectFolder());
-                                        }
-
-                                        parent = it.value();
-                                    }
-                                } else */if (IsKnownNodeName(name)) {
-                                    auto filterElement = element.namedItem(QLatin1String("Filter")).toElement();
-                                    if (filterElement.isElement()) {
-                                        auto relFilePath = element.attributes().namedItem(QLatin1Literal("Include")).nodeValue();
-                                        auto filePath = makeAbsoluteFilePath(relFilePath);
-                                        auto filterName = filterElement.childNodes().at(0).nodeValue();
-                                        VsProjectFolder* parent = rootFolder();
-                                        foreach (const QString& pathComponent, filterName.split(QLatin1Char('\\'), QString::SkipEmptyParts)) {
-                                            auto it = parent->SubFolders.find(pathComponent);
-                                            if (it == parent->SubFolders.end()) {
-                                                it = parent->SubFolders.insert(pathComponent, new VsProjectFolder());
-                                            }
-
-                                            parent = it.value();
-                                        }
-
-                                        parent->Files << filePath;
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
+Vs2010ProjectData::TargetState Vs2010ProjectData::beginTarget(const QString& configuration) const
+{
+    TargetState state;
+    splitConfiguration(configuration, &state.configurationName, &state.platformName);
+
+    auto& sub = state.sub;
+    sub.insert(_Configuration, state.configurationName);
+    sub.insert(_ConfigurationName, state.configurationName);
+    sub.insert(_Platform, state.platformName);
+    sub.insert(_PlatformName, state.platformName);
+    sub.insert(_ProjectDir, projectDirectory().path() + QLatin1String("/"));
+    sub.insert(_SolutionDir, solutionDirectory() + QLatin1String("/"));
+    sub.insert(_ProjectName, projectFilePath().toFileInfo().baseName());
+    sub.insert(_TargetName, sub.value(_ProjectName));
+    // Properties are stored evaluated, like MSBuild does when assigning them
+    VsMacroExpander expander(sub);
+    sub.insert(_OutDir, expander.expand(getDefaultOutputDirectory(state.platformName)));
+    sub.insert(_IntDir, expander.expand(getDefaultIntDirectory(state.platformName)));
+
+    auto& target = state.target;
+    target.targetType = TT_Other;
+    target.configuration = configuration;
+    target.projectFile = projectFilePath().toString();
+    target.title = projectFilePath().toFileInfo().baseName();
+    target.outdir = _OutDir;
+    target.output = _OutDir + _TargetName + _TargetExt;
+    state.defines.add("_MSC_VER", QByteArray::number(m_mscVer));
+
+    return state;
+}
+
+void Vs2010ProjectData::applyConfigurationProperties(TargetState& state, const Properties& properties) const
+{
+    auto& target = state.target;
+    auto configurationType = properties.value(QLatin1String("ConfigurationType"));
+    if (configurationType == QLatin1String("Application")) {
+        target.targetType = TT_ExecutableType;
+        state.sub.insert(_TargetExt, QLatin1String(".exe"));
+    } else if (configurationType == QLatin1String("DynamicLibrary")) {
+        target.targetType = TT_DynamicLibraryType;
+        state.sub.insert(_TargetExt, QLatin1String(".dll"));
+    } else if (configurationType == QLatin1String("StaticLibrary")) {
+        target.targetType = TT_StaticLibraryType;
+        state.sub.insert(_TargetExt, QLatin1String(".lib"));
+    } else if (configurationType == QLatin1String("Utility")) {
+        target.targetType = TT_UtilityType;
+    } else {
+        target.targetType = TT_Other;
+    }
+
+    auto charset = properties.value(QLatin1String("CharacterSet"));
+    if (charset == QLatin1String("Unicode")) {
+        state.defines.add("_UNICODE");
+        state.defines.add("UNICODE");
+    } else if (charset == QLatin1String("MultiByte")) {
+        state.defines.add("_MBCS");
+    }
+
+    auto useOfMfc = properties.value(QLatin1String("UseOfMfc"));
+    if (useOfMfc == QLatin1String("Dynamic")) {
+        state.defines.add("_AFXDLL");
+    }
+}
+
+// The value is expanded against the properties defined so far, so a redefinition
+// like <OutDir>$(OutDir)sub\</OutDir> builds on the previous value
+void Vs2010ProjectData::applyProperty(TargetState& state, const QString& name, const QString& rawValue) const
+{
+    auto value = rawValue;
+    if (value.contains(QLatin1String("$("))) {
+        value = VsMacroExpander(state.sub, VsMacroExpander::DropUnknownMacros).expand(value);
+    }
+
+    if (name == QLatin1String("TargetName")) {
+        state.sub[_TargetName] = value;
+    } else if (name == QLatin1String("OutDir")) {
+        state.sub[_OutDir] = QDir::fromNativeSeparators(value);
+    } else if (name == QLatin1String("IntDir")) {
+        state.sub[_IntDir] = QDir::fromNativeSeparators(value);
+    } else {
+        // user macros, may be referred to by imported property sheets
+        state.sub[QLatin1String("$(") + name + QLatin1Char(')')] = value;
+    }
+}
+
+// Wildcards are expanded against the file system, the directories searched are watched
+QStringList Vs2010ProjectData::itemFiles(const QString& include, const QString& exclude)
+{
+    if (!VsWildcardExpander::hasWildcards(include)) {
+        return QStringList(makeAbsoluteFilePath(include));
+    }
+
+    return VsWildcardExpander::expand(projectDirectory().absolutePath(), include, exclude, &m_directoriesToWatch);
+}
+
+// Only the metadata the code model needs is kept
+void Vs2010ProjectData::addItemMetadata(const QStringList& filePaths, const QString& name, const QString& value, const QString& condition)
+{
+    if (name != ExcludedFromBuild && name != PreprocessorDefinitions && name != AdditionalIncludeDirectories) {
+        return;
+    }
+
+    foreach (const QString& filePath, filePaths) {
+        m_itemMetadata << ItemMetadata{ filePath, name, value, condition };
+    }
+}
+
+// Items are evaluated after all properties, against the final state of the configuration
+Vs2010ProjectData::ItemSettings Vs2010ProjectData::evaluateItemSettings(const TargetState& state) const
+{
+    // Values may refer to properties and property functions, e.g. $(SolutionDir)include
+    VsMacroExpander expander(state.sub);
+    ItemSettings result;
+    for (const auto& item : m_itemMetadata) {
+        if (!matches(state, item.condition)) {
+            continue;
+        }
+
+        const auto value = expander.expand(item.value);
+        if (item.name == ExcludedFromBuild) {
+            if (value.trimmed().compare(QLatin1String("true"), Qt::CaseInsensitive) == 0) {
+                result.excludedFiles.insert(item.filePath);
+            } else {
+                result.excludedFiles.remove(item.filePath);
+            }
+            continue;
+        }
+
+        // %(PreprocessorDefinitions) and friends refer to the inherited values,
+        // the code model adds the target's settings anyway
+        const auto isDefines = item.name == PreprocessorDefinitions;
+        auto& settings = result.fileSettings[item.filePath];
+        VsDefineSet::Builder defines;
+        foreach (const QString& part, value.split(QLatin1Char(';'), QString::SkipEmptyParts)) {
+            if (part.trimmed().startsWith(QLatin1String("%("))) {
+                continue;
             }
+
+            if (isDefines) {
+                defines.addDefinition(part.trimmed());
+            } else {
+                settings.includeDirectories << VsStringPool::intern(makeAbsoluteFilePath(part.trimmed()));
+            }
+        }
+
+        if (isDefines) {
+            settings.defines = VsDefineSet::fromDefines(settings.defines.defines() + defines.build().defines());
+        }
+    }
+
+    for (auto it = result.fileSettings.begin(); it != result.fileSettings.end(); ) {
+        if (it->isEmpty()) {
+            it = result.fileSettings.erase(it);
+        } else {
+            ++it;
         }
     }
+    return result;
+}
+
+// The item settings of a configuration are evaluated along with its target
+Vs2010ProjectData::ItemSettings Vs2010ProjectData::itemSettings(int configurationIndex) const
+{
+    materializedTarget(configurationIndex);
+
+    QMutexLocker locker(materializeMutex());
+    auto it = m_itemSettings.constFind(configurationIndex);
+    if (it == m_itemSettings.constEnd()) {
+        // the target was adopted from the model this one was copied from
+        it = m_itemSettings.insert(configurationIndex, evaluateItemSettings(evaluateState(configurationIndex)));
+    }
+    return it.value();
+}
+
+QStringList Vs2010ProjectData::files(const QString& configuration) const
+{
+    auto index = m_configurations.indexOf(configuration);
+    if (index < 0 || m_itemMetadata.isEmpty()) {
+        return files();
+    }
+
+    const auto excludedFiles = itemSettings(index).excludedFiles;
+    if (excludedFiles.isEmpty()) {
+        return files();
+    }
+
+    QStringList result;
+    foreach (const QString& filePath, files()) {
+        if (!excludedFiles.contains(filePath)) {
+            result << filePath;
+        }
+    }
+    return result;
+}
+
+VsFileSettingsMap Vs2010ProjectData::fileSettings(const VsBuildTarget& target) const
+{
+    auto index = m_configurations.indexOf(target.configuration);
+    if (index < 0 || m_itemMetadata.isEmpty()) {
+        return VsFileSettingsMap();
+    }
+
+    return itemSettings(index).fileSettings;
+}
+
+void Vs2010ProjectData::addOperation(Operation::Type type, const QString& condition, const QString& outerCondition)
+{
+    Operation operation;
+    operation.type = type;
+    operation.condition = condition;
+    operation.outerCondition = outerCondition;
+    m_operations << operation;
+}
+
+// Called with materializeMutex() held
+VsBuildTarget Vs2010ProjectData::evaluateTarget(int configurationIndex) const
+{
+    auto state = evaluateState(configurationIndex);
+    m_itemSettings.insert(configurationIndex, evaluateItemSettings(state));
+    return finishTarget(state);
+}
+
+// Replays the recorded groups for a single configuration
+Vs2010ProjectData::TargetState Vs2010ProjectData::evaluateState(int configurationIndex) const
+{
+    auto state = beginTarget(m_configurations.at(configurationIndex));
+    for (const auto& operation : m_operations) {
+        if (!matches(state, operation.condition, operation.outerCondition)) {
+            continue;
+        }
+
+        switch (operation.type) {
+        case Operation::ConfigurationProperties:
+            applyConfigurationProperties(state, operation.properties);
+            break;
+        case Operation::SetProperty:
+            applyProperty(state, operation.name, operation.value);
+            break;
+        case Operation::ItemDefinitions:
+            applyItemDefinitions(state, operation.properties, operation.link);
+            break;
+        case Operation::Import:
+            applyImport(state, operation.name);
+            break;
+        }
+    }
+
+    return state;
+}
+
+void Vs2010ProjectData::applyImport(TargetState& state, const QString& project) const
+{
+    auto path = VsMacroExpander(state.sub, VsMacroExpander::DropUnknownMacros).expand(project).trimmed();
+    if (!path.isEmpty()) {
+        applyPropertySheet(state, makeAbsoluteFilePath(path), 0);
+    }
+}
+
+void Vs2010ProjectData::applyPropertySheet(TargetState& state, const QString& filePath, int depth) const
+{
+    // guards against sheets importing each other
+    const int MaxImportDepth = 32;
+    if (depth > MaxImportDepth) {
+        qWarning("%s: %s", qPrintable(filePath), "imports nested too deeply");
+        return;
+    }
+
+    auto sheet = VsPropertySheetCache::evaluate(filePath, state.sub);
+    if (!sheet) {
+        return;
+    }
+
+    if (!m_importedFiles.contains(filePath)) {
+        m_importedFiles << filePath;
+    }
+
+    for (const auto& operation : sheet->operations) {
+        switch (operation.type) {
+        case VsPropertySheet::Operation::SetProperty:
+            applyProperty(state, operation.name, operation.value);
+            break;
+        case VsPropertySheet::Operation::ItemDefinitions:
+            applyItemDefinitions(state, operation.clCompile, operation.link);
+            break;
+        case VsPropertySheet::Operation::Import:
+            applyPropertySheet(state, operation.name, depth + 1);
+            break;
+        }
+    }
+}
+
+void Vs2010ProjectData::applyItemDefinitions(TargetState& state, const Properties& clCompile, const Properties& link) const
+{
+    // Values may refer to properties and property functions, e.g. $(SolutionDir)include
+    VsMacroExpander expander(state.sub);
+    auto& target = state.target;
+    auto definitions = expander.expand(clCompile.value(QLatin1String("PreprocessorDefinitions"))).split(QLatin1Char(';'), QString::SkipEmptyParts);
+    foreach (const QString& definition, definitions) {
+        if (definition == QLatin1String("%(PreprocessorDefinitions)")) {
+            continue;
+        }
+
+        state.defines.addDefinition(definition);
+    }
+
+    auto includes = expander.expand(clCompile.value(QLatin1String("AdditionalIncludeDirectories"))).split(QLatin1Char(';'), QString::SkipEmptyParts);
+    foreach (const QString& include, includes) {
+        if (include == QLatin1String("%(AdditionalIncludeDirectories)")) {
+            continue;
+        }
+
+        target.includeDirectories << makeAbsoluteFilePath(include);
+    }
+
+    auto runtimeLibraryIt = clCompile.constFind(QLatin1String("RuntimeLibrary"));
+    if (runtimeLibraryIt != clCompile.constEnd()) {
+        state.runtimeLibrary = runtimeLibraryIt.value();
+    }
+
+    auto outputFileIt = link.constFind(QLatin1String("OutputFile"));
+    if (outputFileIt != link.constEnd()) {
+        target.output = QDir::fromNativeSeparators(outputFileIt.value());
+    }
+}
+
+VsBuildTarget Vs2010ProjectData::finishTarget(TargetState& state) const
+{
+    auto& target = state.target;
+
+    // Several item definition groups may apply, the runtime library is settled last
+    auto rtl = RTL_Other;
+    if (!state.runtimeLibrary.isEmpty()) {
+        const auto& runtimeLibrary = state.runtimeLibrary;
+        if (QLatin1String("MultiThreadedDLL") == runtimeLibrary) {
+            target.compilerOptions << QLatin1String("/MD");
+            rtl = RTL_MD;
+        } else if (QLatin1String("MultiThreadedDebugDLL") == runtimeLibrary) {
+            target.compilerOptions << QLatin1String("/MDd");
+            rtl = RTL_MDd;
+        } else if (QLatin1String("MultiThreaded") == runtimeLibrary) {
+            target.compilerOptions << QLatin1String("/MT");
+            rtl = RTL_MT;
+        } else if (QLatin1String("MultiThreadedDebug") == runtimeLibrary) {
+            target.compilerOptions << QLatin1String("/MTd");
+            rtl = RTL_MTd;
+        }
+    } else { // omitted, assume defaults derived from configuration names
+        if (state.configurationName == Debug) {
+            target.compilerOptions << QLatin1String("/MDd");
+            rtl = RTL_MDd;
+        } else if (state.configurationName == Release) {
+            target.compilerOptions << QLatin1String("/MD");
+            rtl = RTL_MD;
+        }
+    }
+
+    addDefaultDefines(state.defines, state.platformName, rtl);
+    target.defines = state.defines.build();
+
+    addDefaultIncludeDirectories(target.includeDirectories);
+
+    VsMacroExpander expander(state.sub);
+    target.outdir = expander.expand(target.outdir);
+    target.outdir = makeAbsoluteFilePath(target.outdir);
+    target.output = expander.expand(target.output);
+    target.output = makeAbsoluteFilePath(target.output);
+
+    internTarget(target);
+    return target;
 }
 
 VsBuildTargets Vs2010ProjectData::targets() const
 {
-    return m_targets;
+    return materializedTargets();
+}
+
+VsBuildTargets Vs2010ProjectData::targets(const QString& configuration) const
+{
+    return materializedTargets(configuration);
 }
 
 QStringList Vs2010ProjectData::filesToWatch() const
 {
-    return m_filesToWatch;
+    QMutexLocker locker(materializeMutex());
+    auto files = m_filesToWatch;
+    foreach (const QString& filePath, m_importedFiles) {
+        if (!files.contains(filePath)) {
+            files << filePath;
+        }
+    }
+    return files;
 }
 
 void Vs2010ProjectData::buildCmd(const QString& configuration, QString* cmd, QString* args) const
@@ -969,6 +2026,26 @@ void Vs2010ProjectData::cleanCmd(const QString& configuration, QString* cmd, QSt
     makeCmd(configuration, QLatin1String("/t:Clean"), *cmd, *args);
 }
 
+// Referenced projects are not built again, the solution directory is the one of the solution
+void Vs2010ProjectData::buildInSolutionCmd(const QString& configuration, const Utils::FileName& solutionFile, QString* cmd, QString* args) const
+{
+    auto solutionDir = solutionFile.toFileInfo().absolutePath() + QLatin1Char('/');
+    makeCmd(configuration,
+            QString::fromLatin1("/t:Build /p:BuildProjectReferences=false /p:SolutionDir=\"%1\"").arg(solutionDir),
+            *cmd,
+            *args);
+}
+
+QStringList Vs2010ProjectData::projectReferences() const
+{
+    return m_projectReferences;
+}
+
+QStringList Vs2010ProjectData::directoriesToWatch() const
+{
+    return m_directoriesToWatch;
+}
+
 void Vs2010ProjectData::makeCmd(const QString& configuration, const QString& buildSwitch, QString& cmd, QString& args) const
 {
     QString configurationName, platformName;
@@ -26,6 +26,9 @@
 
 #pragma once
 
+#include "vsconditionevaluator.h"
+#include "vsdefineset.h"
+
 #include <projectexplorer/projectnodes.h>
 
 
@@ -35,7 +38,15 @@
 #include <QStringList>
 #include <QDomDocument>
 #include <QHash>
+#include <QBitArray>
+#include <QSet>
 #include <QProcess>
+#include <QFuture>
+#include <QMutex>
+#include <QSharedPointer>
+
+QT_FORWARD_DECLARE_CLASS(QDataStream)
+QT_FORWARD_DECLARE_CLASS(QXmlStreamReader)
 
 #include <utils/fileutils.h>
 
@@ -43,6 +54,8 @@
 namespace VsProjectManager {
 namespace Internal {
 
+class VsXmlTokenizer;
+
 enum TargetType {
     TT_ExecutableType = 0,
     TT_StaticLibraryType = 2,
@@ -68,61 +81,154 @@ public:
     QString title;
     QString output;
     QString outdir;
+    QString projectFile; // project building the target
     TargetType targetType;
 
     // code model
     QStringList includeDirectories;
     QStringList compilerOptions;
-    QByteArray defines;
+    VsDefineSet defines;
 };
 
 typedef QList<VsBuildTarget> VsBuildTargets;
 
+QDataStream& operator<<(QDataStream& stream, const VsBuildTarget& target);
+QDataStream& operator>>(QDataStream& stream, VsBuildTarget& target);
+
+// Settings of a single file in one configuration, in addition to those of its target
+class VsFileSettings
+{
+public:
+    bool isEmpty() const { return defines.isEmpty() && includeDirectories.isEmpty(); }
+    bool operator==(const VsFileSettings& other) const { return defines == other.defines && includeDirectories == other.includeDirectories; }
+
+public:
+    VsDefineSet defines;
+    QStringList includeDirectories;
+};
+
+typedef QHash<QString, VsFileSettings> VsFileSettingsMap; // by file path
+
 class VsProjectFolder
 {
 public:
     ~VsProjectFolder();
     VsProjectFolder() = default;
+    void swap(VsProjectFolder& other);
 public:
     QList<QString> Files;
     QHash<QString, VsProjectFolder*> SubFolders;
 };
 
+class VsProjectData;
+typedef QSharedPointer<VsProjectData> VsProjectDataPtr;
+
 class VsProjectData : public QObject
 {
     Q_OBJECT
 public:
     typedef QHash<QString, QString> VariableSubstitution;
 
+    enum ParserType {
+        DomParser,      // builds a QDomDocument, then evaluates it
+        StreamParser,   // evaluates MSBuild files in a single pass over a QXmlStreamReader
+        TokenizerParser // like StreamParser, but reads the memory mapped file through VsXmlTokenizer
+    };
+
+    // Parts of the model which are derived from different input files
+    enum ModelPart {
+        NoParts = 0x0,
+        TargetsPart = 0x1, // configurations, targets and code model settings
+        FoldersPart = 0x2, // folder hierarchy shown in the project tree
+        AllParts = TargetsPart | FoldersPart
+    };
+    Q_DECLARE_FLAGS(ModelParts, ModelPart)
+
 public:
     virtual ~VsProjectData();
-    static VsProjectData* load(const Utils::FileName& projectFile);
+    // solutionDirectory is that of the solution the project is loaded for, if any
+    static VsProjectData* load(const Utils::FileName& projectFile, const QString& solutionDirectory = QString(), ParserType parser = defaultParser());
+    // Reads just the configuration names, much cheaper than load().configurations()
+    static QStringList scanConfigurations(const Utils::FileName& projectFile);
+    static ParserType defaultParser();
+    // Re-evaluates only the parts of previous which depend on the changed files
+    static VsProjectData* reload(const VsProjectData& previous, const QStringList& changedFiles);
 
 public:
     virtual VsBuildTargets targets() const = 0;
+    // Targets of a single configuration
+    virtual VsBuildTargets targets(const QString& configuration) const;
     virtual QStringList configurations() const = 0;
     virtual QStringList filesToWatch() const = 0;
+    // Directories the file list depends on, e.g. those searched by wildcard items
+    virtual QStringList directoriesToWatch() const;
     virtual void buildCmd(const QString& configuration, QString* cmd, QString* args) const = 0;
     virtual void cleanCmd(const QString& configuration, QString* cmd, QString* args) const = 0;
+    // Builds the project on behalf of the given solution, the projects it references are built by the caller
+    virtual void buildInSolutionCmd(const QString& configuration, const Utils::FileName& solutionFile, QString* cmd, QString* args) const;
+    // Absolute paths of the projects referenced by <ProjectReference> items
+    virtual QStringList projectReferences() const;
     void openInDevenv();
     const QDir& projectDirectory() const { return m_projectDirectory; }
     const Utils::FileName& projectFilePath() const { return m_projectFilePath; }
-    QList<VsProjectData*> subProjects() const { return m_subProjects; }
+    // $(SolutionDir) without trailing slash, the project's own directory if it isn't part of a solution
+    const QString& solutionDirectory() const { return m_solutionDirectory; }
+    static QString resolveSolutionDirectory(const Utils::FileName& projectFile, const QString& solutionDirectory);
+    QList<VsProjectData*> subProjects() const;
     VsProjectFolder* rootFolder() { return &m_rootFolder; }
+    const VsProjectFolder* rootFolder() const { return &m_rootFolder; }
     QStringList files() const;
+    // Files which are built in the given configuration
+    virtual QStringList files(const QString& configuration) const;
+    // Files which are built for the given target
+    virtual QStringList sourceFiles(const VsBuildTarget& target) const;
+    // Files of the target with settings of their own
+    virtual VsFileSettingsMap fileSettings(const VsBuildTarget& target) const;
+    ModelParts recomputedParts() const { return m_recomputedParts; }
+    virtual ModelParts dependentParts(const QString& filePath) const;
+
+    // Serialization of the evaluated model, see VsProjectDataCache
+    virtual void save(QDataStream& stream) const = 0;
+    static VsProjectData* restore(const Utils::FileName& projectFile, QDataStream& stream);
 
 protected:
-    VsProjectData(const Utils::FileName& projectFile, const QDomDocument& doc);
-
+    enum ModelType {
+        Vs2005Model = 1,
+        Vs2010Model = 2,
+        SolutionModel = 3
+    };
+
+    explicit VsProjectData(const Utils::FileName& projectFile, const QString& solutionDirectory = QString());
+    void saveFolders(QDataStream& stream) const;
+    void restoreFolders(QDataStream& stream);
+    // Shares the strings of the model with equal ones of other targets and projects
+    static void internTarget(VsBuildTarget& target);
+    void internFolders();
+    // Creates a copy of this model with the given parts evaluated again, if supported
+    virtual VsProjectData* recompute(ModelParts parts) const;
+    void setRecomputedParts(ModelParts parts) { m_recomputedParts = parts; }
+    // Subprojects are shared with everybody else who loaded them, see VsProjectDataRegistry
+    void addSubProject(const VsProjectDataPtr& project);
+
+    // Targets are evaluated when their configuration is first asked for and kept
+    // afterwards. Evaluation is serialized by materializeMutex().
+    virtual VsBuildTarget evaluateTarget(int configurationIndex) const;
+    VsBuildTarget materializedTarget(int configurationIndex) const;
+    VsBuildTargets materializedTargets() const;
+    VsBuildTargets materializedTargets(const QString& configuration) const;
+    void adoptMaterializedTargets(const VsProjectData& other);
+    QMutex* materializeMutex() const { return &m_materializeMutex; }
 
 protected:
     static void splitConfiguration(const QString& configuration, QString* configurationName, QString* platformName);
     QString makeAbsoluteFilePath(const QString& path) const;
-    static QString substitute(QString input, const VariableSubstitution& sub);
-    const QDomDocument& doc() const { return m_doc; }
+    static QString makeAbsoluteFilePath(const QDir& directory, const QString& path);
     void addDefaultIncludeDirectories(QStringList& includes) const;
-    void addDefaultDefines(QByteArray& defines, const QString& platform, RuntimeLibraryType rtl) const;
+    void addDefaultDefines(VsDefineSet::Builder& defines, const QString& platform, RuntimeLibraryType rtl) const;
     void setInstallDir(const QDir& dir) { m_installDirectory = dir; }
+    void setSolutionDirectory(const QString& directory) { m_solutionDirectory = directory; }
+    // Collects the files of folder which aren't excluded from the configuration at the index
+    static void collectBuildFiles(QStringList& files, const VsProjectFolder& folder, const QHash<QString, QBitArray>& excludedFiles, int configurationIndex);
     const QDir& installDir() const { return m_installDirectory; }
 
 
@@ -131,45 +237,59 @@ private:
     void devenvProcessErrorOccurred(QProcess::ProcessError error);
     void releaseDevenvProcess();
     static void collectFiles(QStringList& files, const VsProjectFolder& folder);
+    static VsProjectData* createFromDocument(const Utils::FileName& projectFilePath, const QDomDocument& doc, const QString& solutionDirectory);
 
 private:
-    QDomDocument m_doc;
     Utils::FileName m_projectFilePath;
     QDir m_projectDirectory;
+    QString m_solutionDirectory;
     QDir m_installDirectory;
     QProcess* m_devenvProcess = nullptr;
-    QList<VsProjectData*> m_subProjects;
+    QList<VsProjectDataPtr> m_subProjects;
     VsProjectFolder m_rootFolder;
+    ModelParts m_recomputedParts = AllParts;
+    mutable QMutex m_materializeMutex;
+    mutable QHash<int, VsBuildTarget> m_materializedTargets; // by configuration index
 };
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(VsProjectData::ModelParts)
+
 class Vs2005ProjectData : public VsProjectData
 {
 public:
-    Vs2005ProjectData(const Utils::FileName& projectFile, const QDomDocument& doc);
+    Vs2005ProjectData(const Utils::FileName& projectFile, const QDomDocument& doc, const QString& solutionDirectory = QString());
+    Vs2005ProjectData(const Utils::FileName& projectFile, QDataStream& stream);
 public:
+    using VsProjectData::files;
+    QStringList files(const QString& configuration) const override;
     VsBuildTargets targets() const override;
+    VsBuildTargets targets(const QString& configuration) const override;
     QStringList configurations() const override;
     QStringList filesToWatch() const override;
     void buildCmd(const QString& configuration, QString* cmd, QString* args) const override;
     void cleanCmd(const QString& configuration, QString* cmd, QString* args) const override;
+    void save(QDataStream& stream) const override;
+
+protected:
+    VsBuildTarget evaluateTarget(int configurationIndex) const override;
 
 private:
+    void init();
     void makeCmd(const QString& configuration, const QString& buildSwitch, QString& cmd, QString& args) const;
 
-    void parseFilter(
-            const QDomNodeList& xmlItems,
-            const QString& configuration,
-            VsProjectFolder& parentFolder) const;
+    void parseFilter(const QDomNodeList& xmlItems, VsProjectFolder& parentFolder);
     static QString getDefaultOutputDirectory(const QString& platform);
     static QString getDefaultIntDirectory(const QString& platform);
 
 private:
-    VsBuildTargets m_targets;
     QStringList m_configurations;
+    // Attributes of each <Configuration> and its tools, the latter keyed as Tool/Attribute
+    QList<VariableSubstitution> m_configurationAttributes;
     QString m_devenvPath;
     QString m_vcvarsPath;
-    QString m_solutionDir;
     QStringList m_filesToWatch;
+    // Per file bitset over m_configurations, set bits exclude the file from that configuration
+    QHash<QString, QBitArray> m_excludedFiles;
 };
 
 
@@ -179,27 +299,140 @@ public:
     Vs2010ProjectData(
             const Utils::FileName& projectFile,
             const QDomDocument& doc,
+            const QString& solutionDirectory,
+            const char* toolsEnvVarName,
+            unsigned mscVer);
+    Vs2010ProjectData(
+            const Utils::FileName& projectFile,
+            QXmlStreamReader& reader,
+            const QString& solutionDirectory,
             const char* toolsEnvVarName,
             unsigned mscVer);
+    Vs2010ProjectData(
+            const Utils::FileName& projectFile,
+            VsXmlTokenizer& tokenizer,
+            const QString& solutionDirectory,
+            const char* toolsEnvVarName,
+            unsigned mscVer);
+    Vs2010ProjectData(const Utils::FileName& projectFile, QDataStream& stream);
 
 public:
+    using VsProjectData::files;
+    QStringList files(const QString& configuration) const override;
+    VsFileSettingsMap fileSettings(const VsBuildTarget& target) const override;
     VsBuildTargets targets() const override;
+    VsBuildTargets targets(const QString& configuration) const override;
     QStringList configurations() const override;
     QStringList filesToWatch() const override;
+    QStringList directoriesToWatch() const override;
     void buildCmd(const QString& configuration, QString* cmd, QString* args) const override;
     void cleanCmd(const QString& configuration, QString* cmd, QString* args) const override;
+    void buildInSolutionCmd(const QString& configuration, const Utils::FileName& solutionFile, QString* cmd, QString* args) const override;
+    QStringList projectReferences() const override;
+    void save(QDataStream& stream) const override;
+    ModelParts dependentParts(const QString& filePath) const override;
+
+protected:
+    VsProjectData* recompute(ModelParts parts) const override;
+    VsBuildTarget evaluateTarget(int configurationIndex) const override;
 
 private:
+    Vs2010ProjectData(const Vs2010ProjectData& previous, ParserType parser);
+
+    typedef QHash<QString, QString> Properties;
+
+    // A group of the project file which applies to the configurations matching its
+    // conditions. The groups are replayed in document order to evaluate a target.
+    struct Operation
+    {
+        enum Type {
+            ConfigurationProperties,
+            SetProperty,
+            ItemDefinitions,
+            Import
+        };
+
+        Type type;
+        QString condition;
+        QString outerCondition;
+        QString name;          // property name or imported project
+        QString value;
+        Properties properties; // configuration properties or ClCompile definitions
+        Properties link;
+    };
+
+    // Child element of an item, e.g. <ExcludedFromBuild> of a <ClCompile>
+    struct ItemMetadata
+    {
+        QString filePath;
+        QString name;
+        QString value;
+        QString condition;
+    };
+
+    // Item metadata of a single configuration
+    struct ItemSettings
+    {
+        QSet<QString> excludedFiles;
+        VsFileSettingsMap fileSettings; // only for files with settings of their own
+    };
+
+    // Evaluation state of a single configuration while its target is materialized
+    struct TargetState
+    {
+        QString configurationName;
+        QString platformName;
+        QString runtimeLibrary;
+        VsDefineSet::Builder defines;
+        VariableSubstitution sub;
+        VsBuildTarget target;
+    };
+
+    void init(const char* toolsEnvVarName, unsigned mscVer);
+    void addItemMetadata(const QStringList& filePaths, const QString& name, const QString& value, const QString& condition);
+    ItemSettings itemSettings(int configurationIndex) const;
+    ItemSettings evaluateItemSettings(const TargetState& state) const;
+    QStringList itemFiles(const QString& include, const QString& exclude);
+    QStringList evaluate(const QDomDocument& doc);
+    template <typename Reader>
+    QStringList evaluateStream(Reader& reader);
+    QFuture<VsProjectFolder*> readFiltersAsync(ParserType parser);
+    void mergeFilters(QFuture<VsProjectFolder*> filters);
+    QString filtersFilePath() const;
+    static VsProjectFolder* readFilters(const QString& filePath, const QString& projectDirectoryPath, ParserType parser);
+    template <typename Reader>
+    static void readFilterItems(Reader& reader, VsProjectFolder& root, const QDir& projectDirectory);
+    static void addToFilter(VsProjectFolder& root, const QDir& projectDirectory, const QString& include, const QString& exclude, const QString& filterName);
+    TargetState beginTarget(const QString& configuration) const;
+    TargetState evaluateState(int configurationIndex) const;
+    bool matches(const TargetState& state, const QString& condition, const QString& outerCondition = QString()) const;
+    void applyConfigurationProperties(TargetState& state, const Properties& properties) const;
+    void applyProperty(TargetState& state, const QString& name, const QString& value) const;
+    void applyItemDefinitions(TargetState& state, const Properties& clCompile, const Properties& link) const;
+    void addOperation(Operation::Type type, const QString& condition, const QString& outerCondition = QString());
+    void applyImport(TargetState& state, const QString& project) const;
+    void applyPropertySheet(TargetState& state, const QString& filePath, int depth) const;
+    VsBuildTarget finishTarget(TargetState& state) const;
     void makeCmd(const QString& configuration, const QString& buildSwitch, QString& cmd, QString& args) const;
     static QString getDefaultOutputDirectory(const QString& platform);
     static QString getDefaultIntDirectory(const QString& platform);
 
 private:
-    VsBuildTargets m_targets;
     QStringList m_configurations;
+    QList<Operation> m_operations;
+    QStringList m_itemFiles; // files listed in the project file, used if there are no filters
+    QStringList m_projectReferences;
+    QStringList m_directoriesToWatch; // searched by wildcard items
+    // Evaluated per configuration along with its target, like the groups in m_operations
+    QList<ItemMetadata> m_itemMetadata;
+    QByteArray m_toolsEnvVarName;
+    unsigned m_mscVer = 0;
     QString m_vcvarsPath;
-    QString m_solutionDir;
     QStringList m_filesToWatch;
+    mutable QStringList m_importedFiles; // property sheets of the materialized targets
+    mutable QHash<int, ItemSettings> m_itemSettings; // by configuration index
+    // Shared by all configurations, used with materializeMutex() held
+    mutable VsConditionEvaluator m_conditions{projectDirectory()};
 };
 
 
@@ -0,0 +1,216 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#include "vsprojectdatacache.h"
+#include "vsprojectdata.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QScopedPointer>
+
+namespace VsProjectManager {
+namespace Internal {
+
+namespace {
+
+const quint32 CacheMagic = 0x56535043; // 'VSPC'
+const quint32 CacheVersion = 13;
+
+QString s_directory;
+
+struct FileStamp
+{
+    QString path;
+    qint64 size = -1;
+    qint64 lastModified = 0;
+    QByteArray hash;
+};
+
+QDataStream& operator<<(QDataStream& stream, const FileStamp& stamp)
+{
+    return stream << stamp.path << stamp.size << stamp.lastModified << stamp.hash;
+}
+
+QDataStream& operator>>(QDataStream& stream, FileStamp& stamp)
+{
+    return stream >> stamp.path >> stamp.size >> stamp.lastModified >> stamp.hash;
+}
+
+QByteArray hashFile(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    if (!hash.addData(&file))
+        return QByteArray();
+
+    return hash.result();
+}
+
+FileStamp stampFile(const QString& path)
+{
+    FileStamp stamp;
+    stamp.path = path;
+
+    QFileInfo fileInfo(path);
+    if (fileInfo.exists()) {
+        stamp.size = fileInfo.size();
+        stamp.lastModified = fileInfo.lastModified().toMSecsSinceEpoch();
+        if (fileInfo.isFile())
+            stamp.hash = hashFile(path);
+    }
+
+    return stamp;
+}
+
+// Size and time stamp are cheap to check, the content hash catches files
+// which were touched or checked out again without actually changing.
+bool isUpToDate(const FileStamp& stamp)
+{
+    QFileInfo fileInfo(stamp.path);
+    if (!fileInfo.exists())
+        return stamp.size < 0;
+
+    // Directories change their time stamp as entries are added, removed or renamed
+    if (fileInfo.isDir())
+        return fileInfo.lastModified().toMSecsSinceEpoch() == stamp.lastModified;
+
+    if (fileInfo.size() != stamp.size)
+        return false;
+
+    if (fileInfo.lastModified().toMSecsSinceEpoch() == stamp.lastModified)
+        return true;
+
+    return hashFile(stamp.path) == stamp.hash;
+}
+
+} // anon
+
+void VsProjectDataCache::setDirectory(const QString& path)
+{
+    s_directory = path;
+}
+
+QString VsProjectDataCache::directory()
+{
+    return s_directory;
+}
+
+QString VsProjectDataCache::entryPath(const Utils::FileName& projectFile, const QString& solutionDirectory)
+{
+    auto name = projectFile.toString() + QLatin1Char('\n') + VsProjectData::resolveSolutionDirectory(projectFile, solutionDirectory);
+    auto key = QCryptographicHash::hash(name.toUtf8(), QCryptographicHash::Sha1);
+    return s_directory + QLatin1Char('/') + QString::fromLatin1(key.toHex()) + QLatin1String(".bin");
+}
+
+VsProjectData* VsProjectDataCache::load(const Utils::FileName& projectFile, const QString& solutionDirectory)
+{
+    if (s_directory.isEmpty())
+        return nullptr;
+
+    QFile file(entryPath(projectFile, solutionDirectory));
+    if (!file.open(QIODevice::ReadOnly))
+        return nullptr;
+
+    auto size = file.size();
+    auto mapped = file.map(0, size);
+    if (!mapped)
+        return nullptr;
+
+    auto bytes = QByteArray::fromRawData(reinterpret_cast<const char*>(mapped), static_cast<int>(size));
+    QDataStream stream(bytes);
+    stream.setVersion(QDataStream::Qt_5_6);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    QString path;
+    stream >> magic >> version >> path;
+    if (magic != CacheMagic || version != CacheVersion || path != projectFile.toString())
+        return nullptr;
+
+    QList<FileStamp> stamps;
+    stream >> stamps;
+    if (stream.status() != QDataStream::Ok)
+        return nullptr;
+
+    for (const auto& stamp : stamps) {
+        if (!isUpToDate(stamp))
+            return nullptr;
+    }
+
+    QScopedPointer<VsProjectData> data(VsProjectData::restore(projectFile, stream));
+    if (!data || stream.status() != QDataStream::Ok) {
+        qWarning("%s: %s", qPrintable(file.fileName()), "corrupt project cache entry");
+        return nullptr;
+    }
+
+    if (data->solutionDirectory() != VsProjectData::resolveSolutionDirectory(projectFile, solutionDirectory))
+        return nullptr;
+
+    return data.take();
+}
+
+bool VsProjectDataCache::store(const VsProjectData& data)
+{
+    if (s_directory.isEmpty())
+        return false;
+
+    if (!QDir().mkpath(s_directory))
+        return false;
+
+    QSaveFile file(entryPath(data.projectFilePath(), data.solutionDirectory()));
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_6);
+
+    QList<FileStamp> stamps;
+    for (const auto& path : data.filesToWatch())
+        stamps << stampFile(path);
+    for (const auto& path : data.directoriesToWatch())
+        stamps << stampFile(path);
+
+    stream << CacheMagic << CacheVersion << data.projectFilePath().toString() << stamps;
+    data.save(stream);
+
+    if (stream.status() != QDataStream::Ok) {
+        file.cancelWriting();
+        return false;
+    }
+
+    return file.commit();
+}
+
+} // namespace Internal
+} // namespace VsProjectManager
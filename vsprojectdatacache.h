@@ -0,0 +1,55 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#pragma once
+
+#include <utils/fileutils.h>
+
+#include <QString>
+
+namespace VsProjectManager {
+namespace Internal {
+
+class VsProjectData;
+
+// Persists evaluated project models between sessions. An entry is only used if
+// none of the files the model was evaluated from changed since it was written.
+class VsProjectDataCache
+{
+public:
+    static void setDirectory(const QString& path);
+    static QString directory();
+
+    // Entries are kept per solution directory, the model depends on $(SolutionDir)
+    static VsProjectData* load(const Utils::FileName& projectFile, const QString& solutionDirectory = QString());
+    static bool store(const VsProjectData& data);
+
+private:
+    static QString entryPath(const Utils::FileName& projectFile, const QString& solutionDirectory);
+};
+
+} // namespace Internal
+} // namespace VsProjectManager
@@ -0,0 +1,225 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+
+#include "vsprojectdataregistry.h"
+#include "vsprojectdatacache.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+#include <QWaitCondition>
+#include <QWeakPointer>
+
+namespace VsProjectManager {
+namespace Internal {
+
+namespace {
+
+struct Stamp
+{
+    QString path;
+    QDateTime lastModified;
+};
+
+struct Entry
+{
+    QWeakPointer<VsProjectData> data; // released by the last user
+    QList<Stamp> stamps;
+    QDateTime created;
+};
+
+QMutex s_mutex;
+QWaitCondition s_loaded;
+QHash<QString, Entry> s_entries; // by key
+QSet<QString> s_loading;         // keys of the projects being loaded
+
+// Projects are referred to by different spellings, file names are case insensitive on Windows
+QString registryKey(const Utils::FileName& projectFile, const QString& solutionDirectory)
+{
+    QFileInfo fileInfo(projectFile.toFileInfo());
+    auto path = fileInfo.canonicalFilePath();
+    if (path.isEmpty()) { // the file doesn't exist
+        path = fileInfo.absoluteFilePath();
+    }
+    return (path + QLatin1Char('\n') + VsProjectData::resolveSolutionDirectory(projectFile, solutionDirectory)).toLower();
+}
+
+QList<Stamp> stampFiles(const VsProjectData& data)
+{
+    QList<Stamp> stamps;
+    foreach (const QString& path, data.filesToWatch() + data.directoriesToWatch()) {
+        stamps << Stamp{ path, QFileInfo(path).lastModified() };
+    }
+    return stamps;
+}
+
+bool isUpToDate(const QList<Stamp>& stamps)
+{
+    for (const auto& stamp : stamps) {
+        if (QFileInfo(stamp.path).lastModified() != stamp.lastModified) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Property sheets are imported as targets are materialized, after the entry was
+// created. They are stamped when they show up, unless they changed meanwhile.
+bool stampNewFiles(const VsProjectData& data, const QDateTime& created, QList<Stamp>& stamps)
+{
+    QSet<QString> stamped;
+    for (const auto& stamp : stamps) {
+        stamped.insert(stamp.path);
+    }
+
+    foreach (const QString& path, data.filesToWatch() + data.directoriesToWatch()) {
+        if (stamped.contains(path)) {
+            continue;
+        }
+
+        auto lastModified = QFileInfo(path).lastModified();
+        if (lastModified > created) {
+            return false;
+        }
+        stamps << Stamp{ path, lastModified };
+        stamped.insert(path);
+    }
+    return true;
+}
+
+// The file system is asked outside the lock, projects are loaded concurrently
+VsProjectDataPtr findEntry(const QString& key)
+{
+    VsProjectDataPtr data;
+    QList<Stamp> stamps;
+    QDateTime created;
+    {
+        QMutexLocker locker(&s_mutex);
+        auto it = s_entries.constFind(key);
+        if (it == s_entries.constEnd()) {
+            return VsProjectDataPtr();
+        }
+        data = it->data.toStrongRef();
+        stamps = it->stamps;
+        created = it->created;
+    }
+
+    const auto stampCount = stamps.size();
+    if (data && isUpToDate(stamps) && stampNewFiles(*data, created, stamps)) {
+        if (stamps.size() > stampCount) {
+            QMutexLocker locker(&s_mutex);
+            auto it = s_entries.find(key);
+            if (it != s_entries.end() && it->data == data) {
+                it->stamps = stamps;
+            }
+        }
+        return data;
+    }
+
+    QMutexLocker locker(&s_mutex);
+    auto it = s_entries.find(key);
+    if (it != s_entries.end() && it->data == data) {
+        s_entries.erase(it);
+    }
+    return VsProjectDataPtr();
+}
+
+VsProjectDataPtr insertEntry(const QString& key, VsProjectData* data)
+{
+    // hand the object over to the GUI thread, it outlives the loading one
+    data->moveToThread(QCoreApplication::instance()->thread());
+    VsProjectDataPtr shared(data, &QObject::deleteLater);
+
+    Entry entry;
+    entry.data = shared;
+    entry.created = QDateTime::currentDateTime();
+    entry.stamps = stampFiles(*data);
+
+    QMutexLocker locker(&s_mutex);
+    s_entries.insert(key, entry);
+    return shared;
+}
+
+} // anon
+
+VsProjectDataPtr VsProjectDataRegistry::acquire(const Utils::FileName& projectFile, const QString& solutionDirectory)
+{
+    const auto key = registryKey(projectFile, solutionDirectory);
+    {
+        // Somebody else may be loading the same project, wait for the result instead
+        QMutexLocker locker(&s_mutex);
+        while (s_loading.contains(key)) {
+            s_loaded.wait(&s_mutex);
+        }
+        s_loading.insert(key);
+    }
+
+    auto shared = findEntry(key);
+    if (!shared) {
+        auto data = VsProjectDataCache::load(projectFile, solutionDirectory);
+        if (!data) {
+            data = VsProjectData::load(projectFile, solutionDirectory);
+            if (data) {
+                VsProjectDataCache::store(*data);
+            }
+        }
+
+        if (data) {
+            shared = insertEntry(key, data);
+        }
+    }
+
+    QMutexLocker locker(&s_mutex);
+    s_loading.remove(key);
+    s_loaded.wakeAll();
+    return shared;
+}
+
+VsProjectDataPtr VsProjectDataRegistry::find(const Utils::FileName& projectFile, const QString& solutionDirectory)
+{
+    return findEntry(registryKey(projectFile, solutionDirectory));
+}
+
+VsProjectDataPtr VsProjectDataRegistry::publish(VsProjectData* data, PublishMode mode)
+{
+    const auto key = registryKey(data->projectFilePath(), data->solutionDirectory());
+    if (mode == ShareExisting) {
+        if (auto shared = findEntry(key)) {
+            delete data;
+            return shared;
+        }
+    }
+
+    return insertEntry(key, data);
+}
+
+} // namespace Internal
+} // namespace VsProjectManager
@@ -0,0 +1,60 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+
+#pragma once
+
+#include "vsprojectdata.h"
+
+namespace VsProjectManager {
+namespace Internal {
+
+// Process wide registry of loaded projects. A project file opened on its own,
+// configured on the kit setup page and referred to by several solutions in the
+// same directory is parsed once. $(SolutionDir) is part of the evaluated model,
+// so a project is loaded once per solution directory. The instance is shared as
+// long as somebody holds on to it and the files it was read from are unchanged.
+// Shared instances live in the GUI thread and are only read from, targets are
+// materialized under their own lock.
+class VsProjectDataRegistry
+{
+public:
+    enum PublishMode {
+        ShareExisting,  // an up to date instance shared already is preferred, e.g. for restored models
+        ReplaceExisting // data is newer than what is shared, e.g. reloaded after a change
+    };
+
+    // Returns the shared instance, the project is loaded if there is none or it is out of date
+    static VsProjectDataPtr acquire(const Utils::FileName& projectFile, const QString& solutionDirectory = QString());
+    // Returns the shared instance if there is an up to date one, nothing is loaded
+    static VsProjectDataPtr find(const Utils::FileName& projectFile, const QString& solutionDirectory = QString());
+    // Shares a freshly evaluated instance. With ShareExisting, data is deleted and
+    // the shared instance is returned instead if there is an up to date one.
+    static VsProjectDataPtr publish(VsProjectData* data, PublishMode mode = ShareExisting);
+};
+
+} // namespace Internal
+} // namespace VsProjectManager
@@ -1,6 +1,6 @@
 include(../../qtcreatorplugin.pri)
 
-QT += xml core
+QT += xml core concurrent
 
 HEADERS += \
     vsprojectplugin.h \
@@ -11,8 +11,21 @@ HEADERS += \
     vsbuildconfiguration.h \
     vsprojectconstants.h \
     vsprojectdata.h \
+    vsprojectdatacache.h \
+    vsprojectdataregistry.h \
     devenvstep.h \
-    vsrunconfiguration.h
+    vsrunconfiguration.h \
+    vsxmltokenizer.h \
+    vsmacroexpander.h \
+    vspropertyfunctions.h \
+    vsconditionevaluator.h \
+    vspropertysheetcache.h \
+    vsstringpool.h \
+    vsdefineset.h \
+    vssolutiondata.h \
+    vssolutionbuildstep.h \
+    vspathnormalizer.h \
+    vswildcardexpander.h
 
 SOURCES += \
     vsprojectplugin.cpp \
@@ -22,8 +35,21 @@ SOURCES += \
     vsproject.cpp \
     vsbuildconfiguration.cpp \
     vsprojectdata.cpp \
+    vsprojectdatacache.cpp \
+    vsprojectdataregistry.cpp \
     devenvstep.cpp \
-    vsrunconfiguration.cpp
+    vsrunconfiguration.cpp \
+    vsxmltokenizer.cpp \
+    vsmacroexpander.cpp \
+    vspropertyfunctions.cpp \
+    vsconditionevaluator.cpp \
+    vspropertysheetcache.cpp \
+    vsstringpool.cpp \
+    vsdefineset.cpp \
+    vssolutiondata.cpp \
+    vssolutionbuildstep.cpp \
+    vspathnormalizer.cpp \
+    vswildcardexpander.cpp
 
 RESOURCES += \
     vsprojectmanager.qrc
@@ -28,9 +28,11 @@
 #include "vsmanager.h"
 #include "vsbuildconfiguration.h"
 #include "devenvstep.h"
+#include "vssolutionbuildstep.h"
 #include "vsrunconfiguration.h"
 #include "vsprojectconstants.h"
 #include "vsproject.h"
+#include "vsprojectdatacache.h"
 
 #include <QStringList>
 #include <QtPlugin>
@@ -39,6 +41,7 @@
 #include <coreplugin/actionmanager/actionmanager.h>
 #include <coreplugin/actionmanager/actioncontainer.h>
 #include <coreplugin/actionmanager/command.h>
+#include <coreplugin/icore.h>
 #include <projectexplorer/projectexplorerconstants.h>
 #include <projectexplorer/projecttree.h>
 #include <utils/mimetypes/mimedatabase.h>
@@ -57,9 +60,11 @@ bool VsProjectPlugin::initialize(const QStringList &arguments,
     const Core::Context projecTreeContext(ProjectExplorer::Constants::C_PROJECT_TREE);
 
     Utils::MimeDatabase::addMimeTypes(QLatin1String(":vsprojectmanager/vsprojectmanager.mimetypes.xml"));
+    VsProjectDataCache::setDirectory(Core::ICore::userResourcePath() + QLatin1String("/vsprojectmanager/cache"));
 
     addAutoReleasedObject(new VsBuildConfigurationFactory);
     addAutoReleasedObject(new DevenvStepFactory);
+    addAutoReleasedObject(new VsSolutionBuildStepFactory);
     addAutoReleasedObject(new VsRunConfigurationFactory);
     m_manager = new VsManager();
     addAutoReleasedObject(m_manager);
@@ -0,0 +1,581 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+
+#include "vspropertyfunctions.h"
+
+#include <QDir>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStringList>
+
+#include <cmath>
+
+namespace VsProjectManager {
+namespace Internal {
+
+namespace {
+
+// The memo is dropped as a whole once it holds that many expressions
+const int MaxMemoSize = 16384;
+
+struct Memo
+{
+    bool supported = false;
+    QString value;
+};
+
+QMutex s_mutex;
+QHash<QString, Memo> s_memo; // by expression, receiver and base directory
+
+bool isNameChar(QChar c)
+{
+    return c.isLetterOrNumber() || c == QLatin1Char('_') || c == QLatin1Char('-');
+}
+
+bool isPathSeparator(QChar c)
+{
+    return c == QLatin1Char('\\') || c == QLatin1Char('/');
+}
+
+QString readName(const QString& text, int& pos)
+{
+    auto start = pos;
+    while (pos < text.size() && isNameChar(text.at(pos))) {
+        ++pos;
+    }
+    return text.mid(start, pos - start);
+}
+
+// Arguments are separated by commas outside of quotes and parentheses, quotes are removed.
+// The text is read as written, so a property reference is part of a single argument.
+bool readArguments(const QString& text, int& pos, QStringList* arguments)
+{
+    ++pos; // (
+    auto depth = 0;
+    QChar quote;
+    QString argument;
+    for (; pos < text.size(); ++pos) {
+        auto c = text.at(pos);
+        if (!quote.isNull()) {
+            if (c == quote) {
+                quote = QChar();
+            }
+        } else if (c == QLatin1Char('\'') || c == QLatin1Char('"') || c == QLatin1Char('`')) {
+            quote = c;
+        } else if (c == QLatin1Char('(')) {
+            ++depth;
+        } else if (c == QLatin1Char(')') && depth > 0) {
+            --depth;
+        } else if ((c == QLatin1Char(',') || c == QLatin1Char(')')) && depth == 0) {
+            argument = argument.trimmed();
+            if (argument.size() >= 2 && argument.at(0) == argument.at(argument.size() - 1)
+                    && (argument.at(0) == QLatin1Char('\'') || argument.at(0) == QLatin1Char('"') || argument.at(0) == QLatin1Char('`'))) {
+                argument = argument.mid(1, argument.size() - 2);
+            } else if (c == QLatin1Char(')') && argument.isEmpty() && arguments->isEmpty()) {
+                ++pos;
+                return true; // no arguments at all
+            }
+
+            *arguments << argument;
+            argument.clear();
+            if (c == QLatin1Char(')')) {
+                ++pos;
+                return true;
+            }
+            continue;
+        }
+        argument += c;
+    }
+    return false;
+}
+
+QString boolean(bool value)
+{
+    return value ? QStringLiteral("True") : QStringLiteral("False");
+}
+
+QString number(double value)
+{
+    if (value == std::floor(value) && std::fabs(value) < 1e15) {
+        return QString::number(static_cast<qint64>(value));
+    }
+    return QString::number(value, 'g', 15);
+}
+
+bool toNumbers(const QStringList& arguments, QList<double>* numbers)
+{
+    for (const auto& argument : arguments) {
+        auto ok = false;
+        *numbers << argument.toDouble(&ok);
+        if (!ok) {
+            return false;
+        }
+    }
+    return !numbers->isEmpty();
+}
+
+// Paths are returned with backslashes, as .NET on Windows does
+QString toBackslashes(QString path)
+{
+    path.replace(QLatin1Char('/'), QLatin1Char('\\'));
+    return path;
+}
+
+bool isRooted(const QString& path)
+{
+    return (!path.isEmpty() && isPathSeparator(path.at(0))) || (path.size() >= 2 && path.at(1) == QLatin1Char(':'));
+}
+
+QString combine(const QStringList& parts)
+{
+    QString result;
+    for (const auto& part : parts) {
+        if (part.isEmpty()) {
+            continue;
+        }
+
+        if (result.isEmpty() || isRooted(part)) {
+            result = part;
+        } else {
+            auto last = result.at(result.size() - 1);
+            if (!isPathSeparator(last) && last != QLatin1Char(':')) {
+                result += QLatin1Char('\\');
+            }
+            result += part;
+        }
+    }
+    return result;
+}
+
+QString fullPath(const QString& baseDirectory, const QString& path)
+{
+    auto absolute = isRooted(path) ? path : baseDirectory + QLatin1Char('/') + path;
+    absolute.replace(QLatin1Char('\\'), QLatin1Char('/'));
+    return toBackslashes(QDir::cleanPath(absolute));
+}
+
+QString ensureTrailingSlash(const QString& path)
+{
+    if (path.isEmpty() || isPathSeparator(path.at(path.size() - 1))) {
+        return path;
+    }
+    return path + QLatin1Char('\\');
+}
+
+int fileNameStart(const QString& path)
+{
+    auto pos = path.size();
+    while (pos > 0 && !isPathSeparator(path.at(pos - 1)) && path.at(pos - 1) != QLatin1Char(':')) {
+        --pos;
+    }
+    return pos;
+}
+
+int extensionStart(const QString& path)
+{
+    auto dot = path.lastIndexOf(QLatin1Char('.'));
+    return dot >= fileNameStart(path) ? dot : path.size();
+}
+
+// Characters MSBuild escapes as %XX
+const char EscapedCharacters[] = "%*?@$();'";
+
+QString escape(const QString& text)
+{
+    QString result;
+    for (auto c : text) {
+        if (c.unicode() < 128 && qstrchr(EscapedCharacters, c.toLatin1())) {
+            result += QLatin1Char('%') + QString::number(c.unicode(), 16).toUpper().rightJustified(2, QLatin1Char('0'));
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+QString unescape(const QString& text)
+{
+    QString result;
+    for (auto i = 0; i < text.size(); ++i) {
+        if (text.at(i) == QLatin1Char('%') && i + 2 < text.size()) {
+            auto ok = false;
+            auto code = text.mid(i + 1, 2).toUShort(&ok, 16);
+            if (ok) {
+                result += QChar(code);
+                i += 2;
+                continue;
+            }
+        }
+        result += text.at(i);
+    }
+    return result;
+}
+
+bool callPath(const QString& member, const QStringList& args, const QString& baseDirectory, QString* result)
+{
+    auto is = [&member](const char* name) { return member.compare(QLatin1String(name), Qt::CaseInsensitive) == 0; };
+
+    if (is("Combine")) {
+        *result = combine(args);
+    } else if (is("GetFullPath") && args.size() == 1) {
+        *result = fullPath(baseDirectory, args.at(0));
+    } else if (is("GetFileName") && args.size() == 1) {
+        *result = args.at(0).mid(fileNameStart(args.at(0)));
+    } else if (is("GetFileNameWithoutExtension") && args.size() == 1) {
+        const auto& path = args.at(0);
+        auto start = fileNameStart(path);
+        *result = path.mid(start, extensionStart(path) - start);
+    } else if (is("GetExtension") && args.size() == 1) {
+        *result = args.at(0).mid(extensionStart(args.at(0)));
+    } else if (is("GetDirectoryName") && args.size() == 1) {
+        auto start = fileNameStart(args.at(0));
+        *result = start > 0 ? args.at(0).left(start - 1) : QString();
+    } else if (is("ChangeExtension") && args.size() == 2) {
+        const auto& path = args.at(0);
+        auto extension = args.at(1);
+        if (!extension.isEmpty() && !extension.startsWith(QLatin1Char('.'))) {
+            extension.prepend(QLatin1Char('.'));
+        }
+        *result = path.left(extensionStart(path)) + extension;
+    } else if (is("IsPathRooted") && args.size() == 1) {
+        *result = boolean(isRooted(args.at(0)));
+    } else if (is("DirectorySeparatorChar") && args.isEmpty()) {
+        *result = QStringLiteral("\\");
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool callString(const QString& member, const QStringList& args, QString* result)
+{
+    auto is = [&member](const char* name) { return member.compare(QLatin1String(name), Qt::CaseInsensitive) == 0; };
+
+    if (is("IsNullOrEmpty") && args.size() == 1) {
+        *result = boolean(args.at(0).isEmpty());
+    } else if (is("IsNullOrWhiteSpace") && args.size() == 1) {
+        *result = boolean(args.at(0).trimmed().isEmpty());
+    } else if (is("Concat")) {
+        *result = args.join(QString());
+    } else if (is("Copy") && args.size() == 1) {
+        *result = args.at(0);
+    } else if (is("Format") && !args.isEmpty()) {
+        *result = args.at(0);
+        for (auto i = 1; i < args.size(); ++i) {
+            result->replace(QLatin1Char('{') + QString::number(i - 1) + QLatin1Char('}'), args.at(i));
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool callMSBuild(const QString& member, const QStringList& args, const QString& baseDirectory, QString* result)
+{
+    auto is = [&member](const char* name) { return member.compare(QLatin1String(name), Qt::CaseInsensitive) == 0; };
+
+    QList<double> numbers;
+    if (is("Add") || is("Subtract") || is("Multiply") || is("Divide") || is("Modulo")) {
+        if (args.size() != 2 || !toNumbers(args, &numbers)) {
+            return false;
+        }
+        auto lhs = numbers.at(0);
+        auto rhs = numbers.at(1);
+        if ((is("Divide") || is("Modulo")) && rhs == 0) {
+            return false;
+        }
+        *result = number(is("Add") ? lhs + rhs
+                         : is("Subtract") ? lhs - rhs
+                         : is("Multiply") ? lhs * rhs
+                         : is("Divide") ? lhs / rhs
+                         : std::fmod(lhs, rhs));
+    } else if (is("BitwiseOr") || is("BitwiseAnd") || is("BitwiseXor")) {
+        if (args.size() != 2 || !toNumbers(args, &numbers)) {
+            return false;
+        }
+        auto lhs = static_cast<qint64>(numbers.at(0));
+        auto rhs = static_cast<qint64>(numbers.at(1));
+        *result = QString::number(is("BitwiseOr") ? lhs | rhs : is("BitwiseAnd") ? lhs & rhs : lhs ^ rhs);
+    } else if (is("ValueOrDefault") && args.size() == 2) {
+        *result = args.at(0).isEmpty() ? args.at(1) : args.at(0);
+    } else if (is("EnsureTrailingSlash") && args.size() == 1) {
+        *result = ensureTrailingSlash(args.at(0));
+    } else if (is("NormalizePath") && !args.isEmpty()) {
+        *result = fullPath(baseDirectory, combine(args));
+    } else if (is("NormalizeDirectory") && !args.isEmpty()) {
+        *result = ensureTrailingSlash(fullPath(baseDirectory, combine(args)));
+    } else if (is("MakeRelative") && args.size() == 2) {
+        auto base = fullPath(baseDirectory, args.at(0)).replace(QLatin1Char('\\'), QLatin1Char('/'));
+        auto path = fullPath(baseDirectory, args.at(1)).replace(QLatin1Char('\\'), QLatin1Char('/'));
+        auto relative = toBackslashes(QDir(base).relativeFilePath(path));
+        *result = !args.at(1).isEmpty() && isPathSeparator(args.at(1).at(args.at(1).size() - 1))
+                ? ensureTrailingSlash(relative) : relative;
+    } else if (is("Escape") && args.size() == 1) {
+        *result = escape(args.at(0));
+    } else if (is("Unescape") && args.size() == 1) {
+        *result = unescape(args.at(0));
+    } else if (is("IsOSPlatform") && args.size() == 1) {
+        *result = boolean(args.at(0).compare(QLatin1String("Windows"), Qt::CaseInsensitive) == 0);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool callStatic(const QString& type, const QString& member, const QStringList& args, const QString& baseDirectory, QString* result)
+{
+    auto is = [&type](const char* name) { return type.compare(QLatin1String(name), Qt::CaseInsensitive) == 0; };
+
+    if (is("System.IO.Path")) {
+        return callPath(member, args, baseDirectory, result);
+    } else if (is("System.String")) {
+        return callString(member, args, result);
+    } else if (is("MSBuild")) {
+        return callMSBuild(member, args, baseDirectory, result);
+    } else if (is("System.Environment") && member.compare(QLatin1String("GetEnvironmentVariable"), Qt::CaseInsensitive) == 0 && args.size() == 1) {
+        *result = QString::fromLocal8Bit(qgetenv(args.at(0).toLocal8Bit().constData()));
+        return true;
+    }
+    return false;
+}
+
+QString trimmed(const QString& value, const QStringList& args, bool start, bool end)
+{
+    const auto characters = args.isEmpty() ? QString() : args.join(QString());
+    auto isTrimmed = [&characters](QChar c) { return characters.isEmpty() ? c.isSpace() : characters.contains(c); };
+
+    auto first = 0;
+    auto last = value.size();
+    while (start && first < last && isTrimmed(value.at(first))) {
+        ++first;
+    }
+    while (end && last > first && isTrimmed(value.at(last - 1))) {
+        --last;
+    }
+    return value.mid(first, last - first);
+}
+
+// String methods, called on the receiver or the result of the previous call
+bool callMethod(const QString& value, const QString& member, const QStringList& args, QString* result)
+{
+    auto is = [&member](const char* name) { return member.compare(QLatin1String(name), Qt::CaseInsensitive) == 0; };
+    auto ok = true;
+    auto intArgument = [&args, &ok](int index) {
+        auto valid = false;
+        auto number = args.at(index).toInt(&valid);
+        ok = ok && valid;
+        return number;
+    };
+
+    if (is("Length") && args.isEmpty()) {
+        *result = QString::number(value.size());
+    } else if ((is("ToLower") || is("ToLowerInvariant")) && args.isEmpty()) {
+        *result = value.toLower();
+    } else if ((is("ToUpper") || is("ToUpperInvariant")) && args.isEmpty()) {
+        *result = value.toUpper();
+    } else if (is("Trim")) {
+        *result = trimmed(value, args, true, true);
+    } else if (is("TrimStart")) {
+        *result = trimmed(value, args, true, false);
+    } else if (is("TrimEnd")) {
+        *result = trimmed(value, args, false, true);
+    } else if (is("Replace") && args.size() == 2 && !args.at(0).isEmpty()) {
+        *result = QString(value).replace(args.at(0), args.at(1));
+    } else if (is("Contains") && args.size() == 1) {
+        *result = boolean(value.contains(args.at(0)));
+    } else if (is("StartsWith") && args.size() == 1) {
+        *result = boolean(value.startsWith(args.at(0)));
+    } else if (is("EndsWith") && args.size() == 1) {
+        *result = boolean(value.endsWith(args.at(0)));
+    } else if (is("Equals") && args.size() == 1) {
+        *result = boolean(value == args.at(0));
+    } else if (is("IndexOf") && args.size() == 1) {
+        *result = QString::number(value.indexOf(args.at(0)));
+    } else if (is("LastIndexOf") && args.size() == 1) {
+        *result = QString::number(value.lastIndexOf(args.at(0)));
+    } else if (is("Substring") && (args.size() == 1 || args.size() == 2)) {
+        auto start = intArgument(0);
+        auto length = args.size() == 2 ? intArgument(1) : value.size() - start;
+        if (!ok || start < 0 || length < 0 || start + length > value.size()) {
+            return false;
+        }
+        *result = value.mid(start, length);
+    } else if (is("Remove") && (args.size() == 1 || args.size() == 2)) {
+        auto start = intArgument(0);
+        auto count = args.size() == 2 ? intArgument(1) : value.size() - start;
+        if (!ok || start < 0 || count < 0 || start + count > value.size()) {
+            return false;
+        }
+        *result = QString(value).remove(start, count);
+    } else if (is("Insert") && args.size() == 2) {
+        auto index = intArgument(0);
+        if (!ok || index < 0 || index > value.size()) {
+            return false;
+        }
+        *result = QString(value).insert(index, args.at(1));
+    } else if ((is("PadLeft") || is("PadRight")) && (args.size() == 1 || args.size() == 2)) {
+        auto width = intArgument(0);
+        auto fill = args.size() == 2 && !args.at(1).isEmpty() ? args.at(1).at(0) : QChar(QLatin1Char(' '));
+        if (!ok) {
+            return false;
+        }
+        *result = is("PadLeft") ? value.rightJustified(width, fill) : value.leftJustified(width, fill);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+struct Call
+{
+    QString member;
+    QStringList arguments;
+};
+
+// [Type]::Member(...).Method(...) or Property.Method(...), the arguments as written
+struct Expression
+{
+    QString type; // the first call is a static one if set
+    QList<Call> calls;
+};
+
+bool readCall(const QString& text, int& pos, Expression* expression)
+{
+    Call call;
+    call.member = readName(text, pos);
+    if (pos < text.size() && text.at(pos) == QLatin1Char('(') && !readArguments(text, pos, &call.arguments)) {
+        return false;
+    }
+    expression->calls << call;
+    return !call.member.isEmpty();
+}
+
+bool parseExpression(const QString& expression, Expression* result)
+{
+    const auto text = expression.trimmed();
+    auto pos = 0;
+
+    if (text.startsWith(QLatin1Char('['))) { // [Type]::Member or [Type]::Member(...)
+        auto close = text.indexOf(QLatin1Char(']'));
+        if (close < 0 || text.midRef(close + 1, 2) != QLatin1String("::")) {
+            return false;
+        }
+
+        result->type = text.mid(1, close - 1).trimmed();
+        pos = close + 3;
+        if (!readCall(text, pos, result)) {
+            return false;
+        }
+    } else if (readName(text, pos).isEmpty()) { // Property.Member...
+        return false;
+    }
+
+    while (pos < text.size()) {
+        if (text.at(pos) != QLatin1Char('.')) {
+            return false;
+        }
+
+        ++pos;
+        if (!readCall(text, pos, result)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool evaluateExpression(const Expression& expression, const QString& receiver, const QString& baseDirectory, QString* result)
+{
+    auto value = receiver;
+    for (auto i = 0; i < expression.calls.size(); ++i) {
+        const auto& call = expression.calls.at(i);
+        auto ok = i == 0 && !expression.type.isEmpty()
+                ? callStatic(expression.type, call.member, call.arguments, baseDirectory, &value)
+                : callMethod(value, call.member, call.arguments, &value);
+        if (!ok) {
+            return false;
+        }
+    }
+
+    *result = value;
+    return true;
+}
+
+} // anon
+
+bool VsPropertyFunctions::evaluate(
+        const QString& expression,
+        const QString& receiver,
+        const QString& baseDirectory,
+        const ArgumentExpander& expandArgument,
+        QString* result)
+{
+    // Arguments are told apart as written, a comma or quote in a property value
+    // they refer to doesn't start another one
+    Expression parsed;
+    if (!parseExpression(expression, &parsed)) {
+        return false;
+    }
+
+    // The expression depends on nothing but the receiver, the base directory and its arguments
+    auto key = expression + QLatin1Char('\n') + receiver + QLatin1Char('\n') + baseDirectory;
+    for (auto& call : parsed.calls) {
+        for (auto& argument : call.arguments) {
+            argument = expandArgument(argument);
+            key += QLatin1Char('\n') + QString::number(argument.size()) + QLatin1Char(':') + argument;
+        }
+    }
+
+    {
+        QMutexLocker locker(&s_mutex);
+        auto it = s_memo.constFind(key);
+        if (it != s_memo.constEnd()) {
+            if (it->supported) {
+                *result = it->value;
+            }
+            return it->supported;
+        }
+    }
+
+    Memo memo;
+    memo.supported = evaluateExpression(parsed, receiver, baseDirectory, &memo.value);
+
+    QMutexLocker locker(&s_mutex);
+    if (s_memo.size() >= MaxMemoSize) {
+        s_memo.clear();
+    }
+    s_memo.insert(key, memo);
+
+    if (memo.supported) {
+        *result = memo.value;
+    }
+    return memo.supported;
+}
+
+} // namespace Internal
+} // namespace VsProjectManager
@@ -0,0 +1,62 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+
+#pragma once
+
+#include <QString>
+
+#include <functional>
+
+namespace VsProjectManager {
+namespace Internal {
+
+// Evaluates MSBuild property functions, the part between "$(" and ")" which is
+// more than a property name:
+//   [System.IO.Path]::Combine($(SolutionDir), 'out')  static functions of System.String,
+//                                                     System.IO.Path and MSBuild
+//   Configuration.ToLower()                           string methods called on a property
+// Registry and file system lookups aren't supported. Results are memoized
+// process wide by expression and the values it depends on, so evaluating the
+// same expression for many configurations and projects costs one evaluation.
+class VsPropertyFunctions
+{
+public:
+    // Expands the properties an argument refers to, called once the arguments are split
+    typedef std::function<QString (const QString& argument)> ArgumentExpander;
+
+    // receiver is the value of the property the expression starts with, relative paths
+    // are resolved against baseDirectory. Returns false if the expression isn't supported.
+    static bool evaluate(
+            const QString& expression,
+            const QString& receiver,
+            const QString& baseDirectory,
+            const ArgumentExpander& expandArgument,
+            QString* result);
+};
+
+} // namespace Internal
+} // namespace VsProjectManager
@@ -0,0 +1,315 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#include "vspropertysheetcache.h"
+#include "vsconditionevaluator.h"
+#include "vsmacroexpander.h"
+#include "vspathnormalizer.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+#include <QStringList>
+#include <QXmlStreamReader>
+
+#include <algorithm>
+
+namespace VsProjectManager {
+namespace Internal {
+
+namespace {
+
+typedef VsPropertySheet::Properties Properties;
+
+// Sheet as read from disk, before conditions and macros are evaluated
+struct RawOperation
+{
+    VsPropertySheet::Operation::Type type;
+    QString condition;
+    QString outerCondition;
+    QString name;
+    QString value;
+    Properties clCompile;
+    Properties link;
+};
+
+struct RawSheet
+{
+    QList<RawOperation> operations;
+    QStringList referencedProperties; // sorted, lower case
+};
+
+struct CacheEntry
+{
+    QDateTime lastModified;
+    QSharedPointer<RawSheet> raw;
+    QHash<QString, VsPropertySheetPtr> evaluated; // by values of the referenced properties
+};
+
+QMutex s_mutex;
+QHash<QString, CacheEntry> s_cache;
+
+void collectReferences(const QString& text, QSet<QString>& references)
+{
+    foreach (const QString& name, VsMacroExpander::referencedNames(text)) {
+        references.insert(name.toLower());
+    }
+}
+
+Properties readProperties(QXmlStreamReader& reader, QSet<QString>& references)
+{
+    Properties properties;
+    while (reader.readNextStartElement()) {
+        auto name = reader.name().toString();
+        auto value = reader.readElementText(QXmlStreamReader::SkipChildElements);
+        collectReferences(value, references);
+        properties.insert(name, value);
+    }
+    return properties;
+}
+
+void readImport(QXmlStreamReader& reader, const QString& outerCondition, RawSheet& sheet, QSet<QString>& references)
+{
+    RawOperation operation;
+    operation.type = VsPropertySheet::Operation::Import;
+    operation.condition = reader.attributes().value(QLatin1String("Condition")).toString();
+    operation.outerCondition = outerCondition;
+    operation.value = reader.attributes().value(QLatin1String("Project")).toString();
+    collectReferences(operation.condition, references);
+    collectReferences(operation.value, references);
+    sheet.operations << operation;
+    reader.skipCurrentElement();
+}
+
+QSharedPointer<RawSheet> readSheet(const QString& filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning("%s: %s", qPrintable(filePath), qPrintable(file.errorString()));
+        return QSharedPointer<RawSheet>();
+    }
+
+    QSharedPointer<RawSheet> sheet(new RawSheet());
+    QSet<QString> references;
+    QXmlStreamReader reader(&file);
+    if (!reader.readNextStartElement() || reader.name() != QLatin1String("Project")) {
+        qWarning("%s: %s", qPrintable(filePath), "not an MSBuild file");
+        return QSharedPointer<RawSheet>();
+    }
+
+    while (reader.readNextStartElement()) {
+        auto condition = reader.attributes().value(QLatin1String("Condition")).toString();
+        collectReferences(condition, references);
+
+        if (reader.name() == QLatin1String("Import")) {
+            readImport(reader, QString(), *sheet, references);
+        } else if (reader.name() == QLatin1String("ImportGroup")) {
+            while (reader.readNextStartElement()) {
+                if (reader.name() == QLatin1String("Import")) {
+                    readImport(reader, condition, *sheet, references);
+                } else {
+                    reader.skipCurrentElement();
+                }
+            }
+        } else if (reader.name() == QLatin1String("PropertyGroup")) {
+            while (reader.readNextStartElement()) {
+                RawOperation operation;
+                operation.type = VsPropertySheet::Operation::SetProperty;
+                operation.condition = reader.attributes().value(QLatin1String("Condition")).toString();
+                operation.outerCondition = condition;
+                operation.name = reader.name().toString();
+                operation.value = reader.readElementText(QXmlStreamReader::SkipChildElements);
+                collectReferences(operation.condition, references);
+                collectReferences(operation.value, references);
+                sheet->operations << operation;
+            }
+        } else if (reader.name() == QLatin1String("ItemDefinitionGroup")) {
+            RawOperation operation;
+            operation.type = VsPropertySheet::Operation::ItemDefinitions;
+            operation.condition = condition;
+            while (reader.readNextStartElement()) {
+                if (reader.name() == QLatin1String("ClCompile")) {
+                    operation.clCompile = readProperties(reader, references);
+                } else if (reader.name() == QLatin1String("Link")) {
+                    operation.link = readProperties(reader, references);
+                } else {
+                    reader.skipCurrentElement();
+                }
+            }
+            sheet->operations << operation;
+        } else {
+            reader.skipCurrentElement();
+        }
+    }
+
+    if (reader.hasError()) {
+        qWarning("%s: %s", qPrintable(filePath), qPrintable(reader.errorString()));
+    }
+
+    sheet->referencedProperties = references.toList();
+    std::sort(sheet->referencedProperties.begin(), sheet->referencedProperties.end());
+    return sheet;
+}
+
+// Only the properties a sheet refers to can influence its evaluation, as well as
+// those their values refer to in turn. Undefined properties differ from empty ones.
+QString evaluationKey(const RawSheet& sheet, const Properties& properties)
+{
+    QHash<QString, QString> values;
+    for (auto it = properties.cbegin(); it != properties.cend(); ++it) {
+        values.insert(it.key().toLower(), it.value());
+    }
+
+    auto names = sheet.referencedProperties;
+    auto seen = names.toSet();
+    for (auto i = 0; i < names.size(); ++i) {
+        auto it = values.constFind(QLatin1String("$(") + names.at(i) + QLatin1Char(')'));
+        if (it == values.constEnd()) {
+            continue;
+        }
+
+        foreach (const QString& reference, VsMacroExpander::referencedNames(it.value())) {
+            auto name = reference.toLower();
+            if (!seen.contains(name)) {
+                seen.insert(name);
+                names << name;
+            }
+        }
+    }
+    std::sort(names.begin(), names.end());
+
+    QString key;
+    for (const auto& name : names) {
+        key += name;
+        auto it = values.constFind(QLatin1String("$(") + name + QLatin1Char(')'));
+        if (it != values.constEnd()) {
+            key += QLatin1Char('=');
+            key += it.value();
+        }
+        key += QLatin1Char('\n');
+    }
+    return key;
+}
+
+Properties expandProperties(const Properties& input, VsMacroExpander& expander)
+{
+    Properties output;
+    for (auto it = input.cbegin(); it != input.cend(); ++it) {
+        output.insert(it.key(), expander.expand(it.value()));
+    }
+    return output;
+}
+
+VsPropertySheetPtr evaluateSheet(const QString& filePath, const RawSheet& raw, Properties properties)
+{
+    QFileInfo fileInfo(filePath);
+    const auto sheetDirectory = fileInfo.absoluteDir();
+    properties.insert(QStringLiteral("$(MSBuildThisFileDirectory)"), sheetDirectory.absolutePath() + QLatin1Char('/'));
+    properties.insert(QStringLiteral("$(MSBuildThisFile)"), fileInfo.fileName());
+
+    // Conditions see the properties set by the sheet so far, too
+    VsConditionEvaluator conditions(sheetDirectory);
+
+    QSharedPointer<VsPropertySheet> sheet(new VsPropertySheet());
+    for (const auto& rawOperation : raw.operations) {
+        if (!conditions.evaluate(conditions.compile(rawOperation.outerCondition), properties)
+                || !conditions.evaluate(conditions.compile(rawOperation.condition), properties)) {
+            continue;
+        }
+
+        VsPropertySheet::Operation operation;
+        operation.type = rawOperation.type;
+        switch (rawOperation.type) {
+        case VsPropertySheet::Operation::SetProperty:
+            // evaluated when assigned, like the properties of the project
+            operation.name = rawOperation.name;
+            operation.value = VsMacroExpander(properties, VsMacroExpander::DropUnknownMacros).expand(rawOperation.value);
+            properties.insert(QLatin1String("$(") + operation.name + QLatin1Char(')'), operation.value);
+            break;
+        case VsPropertySheet::Operation::ItemDefinitions: {
+            VsMacroExpander expander(properties);
+            operation.clCompile = expandProperties(rawOperation.clCompile, expander);
+            operation.link = expandProperties(rawOperation.link, expander);
+            break;
+        }
+        case VsPropertySheet::Operation::Import: {
+            // Imports are relative to the importing file
+            auto path = VsMacroExpander(properties, VsMacroExpander::DropUnknownMacros).expand(rawOperation.value).trimmed();
+            if (path.isEmpty()) {
+                continue;
+            }
+            operation.name = VsPathNormalizer::absoluteFilePath(sheetDirectory.absolutePath(), path);
+            break;
+        }
+        }
+
+        sheet->operations << operation;
+    }
+
+    return sheet;
+}
+
+} // anon
+
+VsPropertySheetPtr VsPropertySheetCache::evaluate(const QString& filePath, const Properties& properties)
+{
+    QFileInfo fileInfo(filePath);
+    if (!fileInfo.exists()) {
+        return VsPropertySheetPtr();
+    }
+
+    const auto lastModified = fileInfo.lastModified();
+    const auto key = fileInfo.absoluteFilePath();
+
+    QMutexLocker locker(&s_mutex);
+    auto& entry = s_cache[key];
+    if (!entry.raw || entry.lastModified != lastModified) {
+        entry.lastModified = lastModified;
+        entry.raw = readSheet(key);
+        entry.evaluated.clear();
+    }
+
+    if (!entry.raw) {
+        return VsPropertySheetPtr();
+    }
+
+    const auto values = evaluationKey(*entry.raw, properties);
+    auto it = entry.evaluated.constFind(values);
+    if (it != entry.evaluated.constEnd()) {
+        return it.value();
+    }
+
+    auto sheet = evaluateSheet(key, *entry.raw, properties);
+    entry.evaluated.insert(values, sheet);
+    return sheet;
+}
+
+} // namespace Internal
+} // namespace VsProjectManager
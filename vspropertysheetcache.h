@@ -0,0 +1,74 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QSharedPointer>
+#include <QString>
+
+namespace VsProjectManager {
+namespace Internal {
+
+// A .props/.targets file evaluated against the properties it was imported with
+class VsPropertySheet
+{
+public:
+    typedef QHash<QString, QString> Properties;
+
+    struct Operation
+    {
+        enum Type {
+            SetProperty,    // name, value
+            ItemDefinitions,// clCompile, link
+            Import          // name is the absolute path of the imported sheet
+        };
+
+        Type type;
+        QString name;
+        QString value;
+        Properties clCompile;
+        Properties link;
+    };
+
+    // in document order
+    QList<Operation> operations;
+};
+
+typedef QSharedPointer<const VsPropertySheet> VsPropertySheetPtr;
+
+// Process wide cache of evaluated property sheets. Sheets shared by many projects
+// are read once and evaluated once per distinct set of properties they refer to.
+class VsPropertySheetCache
+{
+public:
+    // properties are keyed as $(Name), returns a null pointer if the sheet can't be read
+    static VsPropertySheetPtr evaluate(const QString& filePath, const VsPropertySheet::Properties& properties);
+};
+
+} // namespace Internal
+} // namespace VsProjectManager
@@ -0,0 +1,464 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#include "vssolutionbuildstep.h"
+#include "vsproject.h"
+#include "vsprojectconstants.h"
+
+#include <projectexplorer/buildconfiguration.h>
+#include <projectexplorer/buildsteplist.h>
+#include <projectexplorer/ioutputparser.h>
+#include <projectexplorer/msvcparser.h>
+#include <projectexplorer/processparameters.h>
+#include <projectexplorer/projectexplorerconstants.h>
+#include <projectexplorer/target.h>
+#include <utils/qtcprocess.h>
+
+#include <QFormLayout>
+#include <QSpinBox>
+#include <QThread>
+#include <QVariantMap>
+
+using namespace VsProjectManager;
+using namespace VsProjectManager::Internal;
+using namespace VsProjectManager::Constants;
+using namespace ProjectExplorer;
+
+namespace {
+const char SOLUTION_BUILD_STEP_ID[] = "VsProjectManager.SolutionBuildStep";
+const char SOLUTION_BUILD_STEP_CONFIGURATION_KEY[] = "VsProjectManager.SolutionBuildStep.Configuration";
+const char SOLUTION_BUILD_STEP_MAX_CONCURRENT_BUILDS_KEY[] = "VsProjectManager.SolutionBuildStep.MaxConcurrentBuilds";
+
+bool isSolution(const Project* project)
+{
+    return project->projectFilePath().toString().endsWith(QLatin1String(".sln"), Qt::CaseInsensitive);
+}
+} // namespace
+
+VsSolutionBuildStepFactory::VsSolutionBuildStepFactory(QObject *parent) : IBuildStepFactory(parent)
+{ setObjectName(QLatin1String("VsProjectManager::VsSolutionBuildStepFactory")); }
+
+QList<ProjectExplorer::BuildStepInfo> VsSolutionBuildStepFactory::availableSteps(ProjectExplorer::BuildStepList *parent) const
+{
+    if (parent->target()->project()->id() != PROJECT_ID
+            || parent->id() != ProjectExplorer::Constants::BUILDSTEPS_BUILD
+            || !isSolution(parent->target()->project()))
+        return {};
+
+    QString display = tr("Build Projects", "Display name for VsProjectManager::VsSolutionBuildStep id.");
+    return {{ SOLUTION_BUILD_STEP_ID, display }};
+}
+
+BuildStep *VsSolutionBuildStepFactory::create(BuildStepList *parent, Core::Id id)
+{
+    Q_UNUSED(id);
+    return new VsSolutionBuildStep(parent);
+}
+
+BuildStep *VsSolutionBuildStepFactory::clone(BuildStepList *parent, BuildStep *source)
+{
+    return new VsSolutionBuildStep(parent, static_cast<VsSolutionBuildStep *>(source));
+}
+
+BuildStep *VsSolutionBuildStepFactory::restore(BuildStepList *parent, const QVariantMap &map)
+{
+    VsSolutionBuildStep *bs = new VsSolutionBuildStep(parent);
+    if (bs->fromMap(map))
+        return bs;
+    delete bs;
+    return 0;
+}
+
+
+VsSolutionBuildStep::VsSolutionBuildStep(BuildStepList* bsl) : BuildStep(bsl, Core::Id(SOLUTION_BUILD_STEP_ID))
+{
+    ctor();
+}
+
+VsSolutionBuildStep::VsSolutionBuildStep(BuildStepList *bsl, VsSolutionBuildStep *bs) : BuildStep(bsl, bs),
+    m_configuration(bs->m_configuration),
+    m_maxConcurrentBuilds(bs->m_maxConcurrentBuilds)
+{
+    ctor();
+}
+
+VsSolutionBuildStep::~VsSolutionBuildStep()
+{
+    for (auto& job : m_jobs) {
+        releaseJob(job);
+    }
+}
+
+void VsSolutionBuildStep::ctor()
+{
+    setDefaultDisplayName(tr("Build Solution Projects"));
+}
+
+QVariantMap VsSolutionBuildStep::toMap() const
+{
+    QVariantMap map = BuildStep::toMap();
+
+    map.insert(QLatin1String(SOLUTION_BUILD_STEP_CONFIGURATION_KEY), m_configuration);
+    map.insert(QLatin1String(SOLUTION_BUILD_STEP_MAX_CONCURRENT_BUILDS_KEY), m_maxConcurrentBuilds);
+    return map;
+}
+
+bool VsSolutionBuildStep::fromMap(const QVariantMap &map)
+{
+    m_configuration = map.value(QLatin1String(SOLUTION_BUILD_STEP_CONFIGURATION_KEY)).toString();
+    m_maxConcurrentBuilds = qMax(0, map.value(QLatin1String(SOLUTION_BUILD_STEP_MAX_CONCURRENT_BUILDS_KEY)).toInt());
+
+    return BuildStep::fromMap(map);
+}
+
+void VsSolutionBuildStep::setConfiguration(const QString& configuration)
+{
+    m_configuration = configuration;
+}
+
+void VsSolutionBuildStep::setMaxConcurrentBuilds(int count)
+{
+    m_maxConcurrentBuilds = qMax(0, count);
+}
+
+int VsSolutionBuildStep::effectiveMaxConcurrentBuilds() const
+{
+    return m_maxConcurrentBuilds > 0 ? m_maxConcurrentBuilds : defaultMaxConcurrentBuilds();
+}
+
+int VsSolutionBuildStep::defaultMaxConcurrentBuilds()
+{
+    bool ok = false;
+    auto count = qgetenv("QTC_VSPROJECTMANAGER_BUILD_JOBS").toInt(&ok);
+    return ok && count > 0 ? count : qMax(1, QThread::idealThreadCount());
+}
+
+bool VsSolutionBuildStep::init(QList<const BuildStep *> &earlierSteps)
+{
+    Q_UNUSED(earlierSteps);
+
+    BuildConfiguration *bc = buildConfiguration();
+    if (!bc)
+        bc = target()->activeBuildConfiguration();
+    if (!bc)
+        emit addTask(Task::buildConfigurationMissingTask());
+
+    if (!bc) {
+        emitFaultyConfigurationMessage();
+        return false;
+    }
+
+    auto project = static_cast<VsProject*>(bc->target()->project());
+    auto solution = project ? dynamic_cast<const VsSolutionData*>(project->vsProjectData()) : nullptr;
+    if (!solution) {
+        emit addTask(Task(Task::Error,
+                          tr("The project is not a loaded Visual Studio solution."),
+                          Utils::FileName(), -1,
+                          ProjectExplorer::Constants::TASK_CATEGORY_BUILDSYSTEM));
+        emitFaultyConfigurationMessage();
+        return false;
+    }
+
+    for (auto& job : m_jobs) {
+        releaseJob(job);
+    }
+    m_jobs.clear();
+    m_environment = bc->environment();
+
+    auto graph = solution->buildGraph(bc->displayName());
+    for (const auto& node : graph) {
+        ProcessParameters pp;
+        pp.setMacroExpander(bc->macroExpander());
+        pp.setEnvironment(m_environment);
+        pp.setWorkingDirectory(QFileInfo(node.projectFile).absolutePath());
+        pp.setCommand(node.cmd);
+        pp.setArguments(node.args);
+        pp.resolveAll();
+
+        Job job;
+        job.name = node.name;
+        job.workingDirectory = pp.effectiveWorkingDirectory();
+        job.command = pp.effectiveCommand();
+        job.arguments = pp.effectiveArguments();
+        job.pendingDependencies = node.dependencies.size();
+        m_jobs << job;
+    }
+
+    for (auto i = 0; i < graph.size(); ++i) {
+        foreach (int dependency, graph.at(i).dependencies) {
+            m_jobs[dependency].dependents << i;
+        }
+    }
+
+    if (hasCycle()) {
+        emit addTask(Task(Task::Error,
+                          tr("The projects of the solution depend on each other in a cycle."),
+                          project->projectFilePath(), -1,
+                          ProjectExplorer::Constants::TASK_CATEGORY_BUILDSYSTEM));
+        emitFaultyConfigurationMessage();
+        return false;
+    }
+
+    return true;
+}
+
+// Kahn's algorithm, projects left over are part of or depend on a cycle
+bool VsSolutionBuildStep::hasCycle() const
+{
+    QList<int> pending;
+    QList<int> ready;
+    for (auto i = 0; i < m_jobs.size(); ++i) {
+        pending << m_jobs.at(i).pendingDependencies;
+        if (!pending.last()) {
+            ready << i;
+        }
+    }
+
+    auto ordered = 0;
+    while (!ready.isEmpty()) {
+        auto index = ready.takeLast();
+        ++ordered;
+        foreach (int dependent, m_jobs.at(index).dependents) {
+            if (!--pending[dependent]) {
+                ready << dependent;
+            }
+        }
+    }
+
+    return ordered != m_jobs.size();
+}
+
+// Processes are started and observed from the event loop, run() returns right away
+bool VsSolutionBuildStep::runInGuiThread() const
+{
+    return true;
+}
+
+void VsSolutionBuildStep::run(QFutureInterface<bool> &interface)
+{
+    m_futureInterface = &interface;
+    m_runningJobs = 0;
+    m_finishedJobs = 0;
+    m_canceled = false;
+
+    emit addOutput(tr("Building %n project(s), at most %1 at a time.", 0, m_jobs.size())
+                   .arg(qMin(effectiveMaxConcurrentBuilds(), qMax(1, m_jobs.size()))),
+                   BuildStep::OutputFormat::NormalMessage);
+    startReadyJobs();
+}
+
+void VsSolutionBuildStep::cancel()
+{
+    m_canceled = true;
+    for (auto& job : m_jobs) {
+        if (job.state == Running) {
+            job.process->kill();
+        }
+    }
+}
+
+void VsSolutionBuildStep::startReadyJobs()
+{
+    if (!m_canceled) {
+        auto maxRunningJobs = effectiveMaxConcurrentBuilds();
+        for (auto i = 0; i < m_jobs.size() && m_runningJobs < maxRunningJobs; ++i) {
+            if (m_jobs.at(i).state == Waiting && !m_jobs.at(i).pendingDependencies) {
+                startJob(i);
+            }
+        }
+    }
+
+    // Without a cycle some job is ready as long as any is waiting
+    if (!m_runningJobs) {
+        finish();
+    }
+}
+
+void VsSolutionBuildStep::startJob(int index)
+{
+    auto& job = m_jobs[index];
+    job.state = Running;
+    ++m_runningJobs;
+
+    job.parser = new MsvcParser();
+    job.parser->setWorkingDirectory(job.workingDirectory);
+    // Output lines are prefixed, tasks are not linked to them
+    connect(job.parser, &IOutputParser::addTask, this, [this](const Task& task) { emit addTask(task); });
+
+    job.process = new Utils::QtcProcess(this);
+    job.process->setProcessChannelMode(QProcess::MergedChannels);
+    job.process->setEnvironment(m_environment);
+    job.process->setWorkingDirectory(job.workingDirectory);
+    job.process->setCommand(job.command, job.arguments);
+    connect(job.process, &QProcess::readyReadStandardOutput, this, [this, index]() { readOutput(index); });
+    connect(job.process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this,
+            [this, index](int exitCode, QProcess::ExitStatus exitStatus) { processFinished(index, exitCode, exitStatus); });
+
+    emit addOutput(tr("%1>Build started: %2").arg(index + 1).arg(job.name), BuildStep::OutputFormat::NormalMessage);
+    job.process->start();
+}
+
+// Lines of concurrent builds interleave, each one is prefixed with the number of its project
+void VsSolutionBuildStep::readOutput(int index)
+{
+    auto& job = m_jobs[index];
+    auto prefix = QString::number(index + 1) + QLatin1Char('>');
+    while (job.process->canReadLine()) {
+        auto line = QString::fromLocal8Bit(job.process->readLine());
+        job.parser->stdOutput(line);
+        emit addOutput(prefix + line, BuildStep::OutputFormat::Stdout, BuildStep::DontAppendNewline);
+    }
+}
+
+void VsSolutionBuildStep::processFinished(int index, int exitCode, QProcess::ExitStatus exitStatus)
+{
+    auto& job = m_jobs[index];
+    readOutput(index);
+    auto rest = QString::fromLocal8Bit(job.process->readAll());
+    if (!rest.isEmpty()) {
+        job.parser->stdOutput(rest);
+        emit addOutput(QString::number(index + 1) + QLatin1Char('>') + rest, BuildStep::OutputFormat::Stdout);
+    }
+    job.parser->flush();
+
+    auto success = exitStatus == QProcess::NormalExit && exitCode == 0;
+    job.state = success ? Succeeded : Failed;
+    --m_runningJobs;
+    ++m_finishedJobs;
+    releaseJob(job);
+
+    if (success) {
+        emit addOutput(tr("%1>Build succeeded: %2").arg(index + 1).arg(job.name), BuildStep::OutputFormat::NormalMessage);
+        foreach (int dependent, job.dependents) {
+            --m_jobs[dependent].pendingDependencies;
+        }
+    } else {
+        emit addOutput(tr("%1>Build failed: %2").arg(index + 1).arg(job.name), BuildStep::OutputFormat::ErrorMessage);
+        skipDependents(index);
+    }
+
+    emit progress(m_finishedJobs * 100 / m_jobs.size(), QString());
+    startReadyJobs();
+}
+
+// Projects depending on a failed one are not built, independent ones still are
+void VsSolutionBuildStep::skipDependents(int index)
+{
+    foreach (int dependent, m_jobs.at(index).dependents) {
+        auto& job = m_jobs[dependent];
+        if (job.state == Waiting) {
+            job.state = Skipped;
+            ++m_finishedJobs;
+            emit addOutput(tr("%1>Build skipped: %2, a project it depends on failed").arg(dependent + 1).arg(job.name),
+                           BuildStep::OutputFormat::ErrorMessage);
+            skipDependents(dependent);
+        }
+    }
+}
+
+void VsSolutionBuildStep::releaseJob(Job& job)
+{
+    if (job.process) {
+        job.process->disconnect(this);
+        if (job.process->state() != QProcess::NotRunning) {
+            job.process->kill();
+            job.process->waitForFinished();
+        }
+        // may be called from the finished signal of the process
+        job.process->deleteLater();
+        job.process = nullptr;
+    }
+
+    delete job.parser;
+    job.parser = nullptr;
+}
+
+void VsSolutionBuildStep::finish()
+{
+    if (!m_futureInterface) {
+        return;
+    }
+
+    auto success = !m_canceled;
+    for (const auto& job : m_jobs) {
+        success = success && job.state == Succeeded;
+    }
+
+    auto interface = m_futureInterface;
+    m_futureInterface = nullptr;
+    reportRunResult(*interface, success);
+}
+
+ProjectExplorer::BuildStepConfigWidget *VsSolutionBuildStep::createConfigWidget()
+{
+    return new VsSolutionBuildStepConfigWidget(this);
+}
+
+bool VsSolutionBuildStep::immutable() const
+{
+    return false;
+}
+
+
+VsSolutionBuildStepConfigWidget::VsSolutionBuildStepConfigWidget(VsSolutionBuildStep *step) :
+    m_step(step),
+    m_summaryText(),
+    m_maxConcurrentBuilds(0)
+{
+    QFormLayout *fl = new QFormLayout(this);
+    fl->setMargin(0);
+    fl->setFieldGrowthPolicy(QFormLayout::ExpandingFieldsGrow);
+    setLayout(fl);
+
+    m_maxConcurrentBuilds = new QSpinBox(this);
+    m_maxConcurrentBuilds->setRange(0, 256);
+    m_maxConcurrentBuilds->setSpecialValueText(tr("Default (%1)").arg(VsSolutionBuildStep::defaultMaxConcurrentBuilds()));
+    m_maxConcurrentBuilds->setValue(m_step->maxConcurrentBuilds());
+    fl->addRow(tr("Parallel project builds:"), m_maxConcurrentBuilds);
+
+    updateDetails();
+
+    connect(m_maxConcurrentBuilds, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, [this](int count) {
+        m_step->setMaxConcurrentBuilds(count);
+        updateDetails();
+    });
+}
+
+QString VsSolutionBuildStepConfigWidget::displayName() const
+{
+    return tr("Build Projects", "VSProjectManager::VsSolutionBuildStepConfigWidget display name.");
+}
+
+QString VsSolutionBuildStepConfigWidget::summaryText() const
+{
+    return m_summaryText;
+}
+
+void VsSolutionBuildStepConfigWidget::updateDetails()
+{
+    m_summaryText = tr("<b>%1:</b> up to %n project(s) at a time", 0, m_step->effectiveMaxConcurrentBuilds()).arg(displayName());
+    emit updateSummary();
+}
@@ -0,0 +1,158 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#pragma once
+
+#include "vssolutiondata.h"
+
+#include <projectexplorer/buildstep.h>
+#include <utils/environment.h>
+
+#include <QProcess>
+
+QT_BEGIN_NAMESPACE
+class QSpinBox;
+QT_END_NAMESPACE
+
+namespace Utils { class QtcProcess; }
+namespace ProjectExplorer { class IOutputParser; }
+
+namespace VsProjectManager {
+namespace Internal {
+
+class VsSolutionBuildStepFactory : public ProjectExplorer::IBuildStepFactory
+{
+    Q_OBJECT
+
+public:
+    VsSolutionBuildStepFactory(QObject *parent = 0);
+
+    virtual QList<ProjectExplorer::BuildStepInfo> availableSteps(ProjectExplorer::BuildStepList *parent) const override;
+    virtual ProjectExplorer::BuildStep *create(ProjectExplorer::BuildStepList *parent, Core::Id id) override;
+    virtual ProjectExplorer::BuildStep *clone(ProjectExplorer::BuildStepList *parent, ProjectExplorer::BuildStep *source) override;
+    virtual ProjectExplorer::BuildStep *restore(ProjectExplorer::BuildStepList *parent, const QVariantMap &map) override;
+};
+
+
+// Builds the projects of a solution one process per project. Projects whose
+// prerequisites are built run concurrently, up to a configurable limit.
+class VsSolutionBuildStep : public ProjectExplorer::BuildStep
+{
+    Q_OBJECT
+    friend class VsSolutionBuildStepFactory;
+    friend class VsSolutionBuildStepConfigWidget;
+
+public:
+    explicit VsSolutionBuildStep(ProjectExplorer::BuildStepList *bsl);
+    ~VsSolutionBuildStep() override;
+
+    virtual bool init(QList<const BuildStep *> &earlierSteps) override;
+
+    virtual void run(QFutureInterface<bool> &interface) override;
+    virtual bool runInGuiThread() const override;
+    virtual void cancel() override;
+    virtual ProjectExplorer::BuildStepConfigWidget *createConfigWidget() override;
+    virtual QVariantMap toMap() const override;
+    void setConfiguration(const QString& configuration);
+    // 0 selects defaultMaxConcurrentBuilds()
+    void setMaxConcurrentBuilds(int count);
+    int maxConcurrentBuilds() const { return m_maxConcurrentBuilds; }
+    int effectiveMaxConcurrentBuilds() const;
+    virtual bool immutable() const override;
+
+    // One build per core, QTC_VSPROJECTMANAGER_BUILD_JOBS overrides the default
+    static int defaultMaxConcurrentBuilds();
+
+protected:
+    VsSolutionBuildStep(ProjectExplorer::BuildStepList *bsl, VsSolutionBuildStep *bs);
+    virtual bool fromMap(const QVariantMap &map) override;
+
+private:
+    enum JobState {
+        Waiting,
+        Running,
+        Succeeded,
+        Failed,
+        Skipped
+    };
+
+    struct Job
+    {
+        QString name;
+        QString workingDirectory;
+        QString command;
+        QString arguments;
+        QList<int> dependents;
+        int pendingDependencies = 0;
+        JobState state = Waiting;
+        Utils::QtcProcess* process = nullptr;
+        ProjectExplorer::IOutputParser* parser = nullptr;
+    };
+
+    void ctor();
+    bool hasCycle() const;
+    void startReadyJobs();
+    void startJob(int index);
+    void readOutput(int index);
+    void processFinished(int index, int exitCode, QProcess::ExitStatus exitStatus);
+    void skipDependents(int index);
+    void releaseJob(Job& job);
+    void finish();
+
+private:
+    QString m_configuration;
+    int m_maxConcurrentBuilds = 0;
+
+    // Build state, set up by init()
+    QList<Job> m_jobs;
+    Utils::Environment m_environment;
+    QFutureInterface<bool>* m_futureInterface = nullptr;
+    int m_runningJobs = 0;
+    int m_finishedJobs = 0;
+    bool m_canceled = false;
+};
+
+
+class VsSolutionBuildStepConfigWidget : public ProjectExplorer::BuildStepConfigWidget
+{
+    Q_OBJECT
+
+public:
+    VsSolutionBuildStepConfigWidget(VsSolutionBuildStep *step);
+
+    QString displayName() const override;
+    QString summaryText() const override;
+
+private:
+    void updateDetails();
+
+    VsSolutionBuildStep *m_step;
+    QString m_summaryText;
+    QSpinBox *m_maxConcurrentBuilds;
+};
+
+} // namespace Internal
+} // namespace VsProjectManager
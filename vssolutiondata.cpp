@@ -0,0 +1,478 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#include "vssolutiondata.h"
+#include "vsprojectdataregistry.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrentRun>
+
+namespace VsProjectManager {
+namespace Internal {
+
+namespace {
+
+// Solution folders and other non C++ entries are skipped
+bool isProjectFile(const QString& filePath)
+{
+    return filePath.endsWith(QLatin1String(".vcxproj"), Qt::CaseInsensitive)
+            || filePath.endsWith(QLatin1String(".vcproj"), Qt::CaseInsensitive);
+}
+
+// Extracts the quoted strings of a line, i.e. Project("{type}") = "name", "path", "{guid}"
+QList<QByteArray> quotedStrings(const QByteArray& line)
+{
+    QList<QByteArray> result;
+    auto pos = 0;
+    while (true) {
+        auto start = line.indexOf('"', pos);
+        if (start < 0) {
+            break;
+        }
+        auto end = line.indexOf('"', start + 1);
+        if (end < 0) {
+            break;
+        }
+        result << line.mid(start + 1, end - start - 1);
+        pos = end + 1;
+    }
+    return result;
+}
+
+// Visual Studio treats paths case insensitively
+QString graphKey(const QString& filePath)
+{
+    return QDir::cleanPath(filePath).toLower();
+}
+
+} // anon
+
+VsSolutionData::VsSolutionData(const Utils::FileName& solutionFile)
+    : VsProjectData(solutionFile)
+{
+    m_filesToWatch << solutionFile.toFileInfo().absoluteFilePath();
+
+    loadProjects(parse());
+}
+
+VsSolutionData::VsSolutionData(const Utils::FileName& solutionFile, QDataStream& stream)
+    : VsProjectData(solutionFile)
+{
+    QByteArray toolsEnvVarName;
+    qint32 projectCount = 0;
+    stream >> toolsEnvVarName
+           >> m_configurations
+           >> m_projectConfigurations
+           >> m_builtProjects
+           >> m_projectDependencies
+           >> m_filesToWatch
+           >> projectCount;
+    init(toolsEnvVarName);
+
+    for (qint32 i = 0; i < projectCount && stream.status() == QDataStream::Ok; ++i) {
+        QString guid, filePath;
+        stream >> guid >> filePath;
+        auto project = VsProjectData::restore(Utils::FileName::fromString(filePath), stream);
+        if (!project) {
+            stream.setStatus(QDataStream::ReadCorruptData);
+            break;
+        }
+        m_projectGuids << guid;
+        addSubProject(VsProjectDataRegistry::publish(project));
+    }
+}
+
+void VsSolutionData::save(QDataStream& stream) const
+{
+    stream << static_cast<quint8>(SolutionModel)
+           << m_toolsEnvVarName
+           << m_configurations
+           << m_projectConfigurations
+           << m_builtProjects
+           << m_projectDependencies
+           << m_filesToWatch
+           << static_cast<qint32>(subProjects().size());
+
+    auto projects = subProjects();
+    for (auto i = 0; i < projects.size(); ++i) {
+        stream << m_projectGuids.at(i) << projects.at(i)->projectFilePath().toString();
+        projects.at(i)->save(stream);
+    }
+}
+
+QStringList VsSolutionData::scanConfigurations(const Utils::FileName& solutionFile)
+{
+    QStringList configurations;
+    QFile file(solutionFile.toString());
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning("%s: %s", qPrintable(solutionFile.toString()), qPrintable(file.errorString()));
+        return configurations;
+    }
+
+    // The section comes right at the start of the Global block, the rest is never read
+    auto inSection = false;
+    while (!file.atEnd()) {
+        auto line = file.readLine().trimmed();
+        if (line.startsWith("GlobalSection(SolutionConfigurationPlatforms)")) {
+            inSection = true;
+        } else if (inSection && line.startsWith("EndGlobalSection")) {
+            break;
+        } else if (inSection) {
+            auto equals = line.indexOf('=');
+            if (equals >= 0) {
+                configurations << QString::fromUtf8(line.left(equals).trimmed());
+            }
+        }
+    }
+
+    return configurations;
+}
+
+int VsSolutionData::loaderThreadCount()
+{
+    bool ok = false;
+    auto count = qgetenv("QTC_VSPROJECTMANAGER_LOAD_THREADS").toInt(&ok);
+    return ok && count > 0 ? count : qMax(1, QThread::idealThreadCount());
+}
+
+// The .sln format is line based, only the project entries and the
+// configuration sections are of interest.
+QList<VsSolutionData::ProjectEntry> VsSolutionData::parse()
+{
+    QList<ProjectEntry> entries;
+
+    QFile file(projectFilePath().toString());
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning("%s: %s", qPrintable(projectFilePath().toString()), qPrintable(file.errorString()));
+        init("VS140COMNTOOLS");
+        return entries;
+    }
+
+    QByteArray toolsEnvVarName("VS110COMNTOOLS");
+    enum Section { NoSection, SolutionConfigurations, ProjectConfigurations, ProjectDependencies } section = NoSection;
+    QString projectGuid; // of the enclosing Project entry
+
+    const auto content = file.readAll();
+    auto pos = content.startsWith("\xEF\xBB\xBF") ? 3 : 0;
+    while (pos < content.size()) {
+        auto end = content.indexOf('\n', pos);
+        if (end < 0) {
+            end = content.size();
+        }
+        const auto line = content.mid(pos, end - pos).trimmed();
+        pos = end + 1;
+
+        if (line.startsWith("Project(")) {
+            auto strings = quotedStrings(line);
+            projectGuid.clear();
+            if (strings.size() >= 4) {
+                projectGuid = QString::fromUtf8(strings.at(3)).toUpper();
+                auto filePath = makeAbsoluteFilePath(QString::fromUtf8(strings.at(2)));
+                if (isProjectFile(filePath)) {
+                    entries << ProjectEntry{ projectGuid, filePath };
+                }
+            }
+        } else if (line.startsWith("GlobalSection(SolutionConfigurationPlatforms)")) {
+            section = SolutionConfigurations;
+        } else if (line.startsWith("GlobalSection(ProjectConfigurationPlatforms)")) {
+            section = ProjectConfigurations;
+        } else if (line.startsWith("ProjectSection(ProjectDependencies)")) {
+            section = ProjectDependencies;
+        } else if (line.startsWith("EndGlobalSection") || line.startsWith("EndProjectSection")) {
+            section = NoSection;
+        } else if (section != NoSection) {
+            // Debug|Win32 = Debug|Win32, {guid}.Debug|Win32.ActiveCfg = Debug|x64 or {guid} = {guid}
+            auto equals = line.indexOf('=');
+            if (equals < 0) {
+                continue;
+            }
+
+            auto key = QString::fromUtf8(line.left(equals).trimmed());
+            auto value = QString::fromUtf8(line.mid(equals + 1).trimmed());
+            if (section == SolutionConfigurations) {
+                m_configurations << key;
+            } else if (section == ProjectDependencies) {
+                if (!projectGuid.isEmpty()) {
+                    m_projectDependencies[projectGuid] << key.toUpper();
+                }
+            } else if (key.endsWith(QLatin1String(".Build.0"))) {
+                auto dot = key.indexOf(QLatin1Char('.'));
+                auto guid = key.left(dot).toUpper();
+                auto configuration = key.mid(dot + 1, key.size() - dot - 1 - int(qstrlen(".Build.0")));
+                m_builtProjects.insert(configuration + QLatin1Char('\n') + guid);
+            } else if (key.endsWith(QLatin1String(".ActiveCfg"))) {
+                auto dot = key.indexOf(QLatin1Char('.'));
+                auto guid = key.left(dot).toUpper();
+                auto configuration = key.mid(dot + 1, key.size() - dot - 1 - int(qstrlen(".ActiveCfg")));
+                m_projectConfigurations.insert(configuration + QLatin1Char('\n') + guid, value);
+            }
+        } else if (line.startsWith("Microsoft Visual Studio Solution File, Format Version ")) {
+            auto version = line.mid(line.lastIndexOf(' ') + 1);
+            if (version == "9.00") {
+                toolsEnvVarName = "VS80COMNTOOLS";
+            } else if (version == "10.00") {
+                toolsEnvVarName = "VS90COMNTOOLS";
+            } else if (version == "11.00") {
+                toolsEnvVarName = "VS100COMNTOOLS";
+            }
+        } else if (line.startsWith("VisualStudioVersion")) {
+            // VS2013 and later, absent for VS2012
+            auto version = line.mid(line.indexOf('=') + 1).trimmed();
+            if (version.startsWith("12.")) {
+                toolsEnvVarName = "VS120COMNTOOLS";
+            } else if (version.startsWith("14.")) {
+                toolsEnvVarName = "VS140COMNTOOLS";
+            }
+        }
+    }
+
+    init(toolsEnvVarName);
+    return entries;
+}
+
+// Projects are independent of each other, they are loaded on a bounded pool of threads.
+// Projects loaded already, e.g. by another solution in the same directory, are shared.
+// $(SolutionDir) of the projects is the directory of the solution.
+void VsSolutionData::loadProjects(const QList<ProjectEntry>& entries)
+{
+    QThreadPool pool;
+    pool.setMaxThreadCount(loaderThreadCount());
+
+    QList<QFuture<VsProjectDataPtr>> futures;
+    futures.reserve(entries.size());
+    for (const auto& entry : entries) {
+        futures << QtConcurrent::run(&pool, &VsProjectDataRegistry::acquire, Utils::FileName::fromString(entry.filePath), solutionDirectory());
+    }
+
+    for (auto i = 0; i < entries.size(); ++i) {
+        auto project = futures[i].result();
+        if (!project) {
+            continue;
+        }
+
+        m_projectGuids << entries.at(i).guid;
+        addSubProject(project);
+    }
+}
+
+void VsSolutionData::init(const QByteArray& toolsEnvVarName)
+{
+    m_toolsEnvVarName = toolsEnvVarName;
+
+    auto toolsPath = qgetenv(toolsEnvVarName.constData());
+    auto installDir = QDir(QString::fromLocal8Bit(toolsPath));
+    installDir.cdUp();
+    installDir.cdUp();
+    setInstallDir(installDir);
+
+    m_vcvarsPath = QDir::toNativeSeparators(installDir.absoluteFilePath(QLatin1String("VC/vcvarsall.bat")));
+}
+
+QString VsSolutionData::projectConfiguration(const QString& configuration, const QString& guid) const
+{
+    return m_projectConfigurations.value(configuration + QLatin1Char('\n') + guid, configuration);
+}
+
+// Projects without any Build.0 entry predate the mapping, they are built in all configurations
+bool VsSolutionData::isBuilt(const QString& configuration, const QString& guid) const
+{
+    return m_builtProjects.isEmpty() || m_builtProjects.contains(configuration + QLatin1Char('\n') + guid);
+}
+
+VsBuildGraph VsSolutionData::buildGraph(const QString& configuration) const
+{
+    VsBuildGraph graph;
+    QHash<QString, int> nodeByGuid;
+    QHash<QString, int> nodeByFile;
+    QList<int> projectIndexes;
+
+    auto projects = subProjects();
+    for (auto i = 0; i < projects.size(); ++i) {
+        const auto& guid = m_projectGuids.at(i);
+        if (!isBuilt(configuration, guid)) {
+            continue;
+        }
+
+        VsBuildGraphNode node;
+        node.projectFile = projects.at(i)->projectFilePath().toString();
+        node.name = QFileInfo(node.projectFile).completeBaseName();
+        projects.at(i)->buildInSolutionCmd(projectConfiguration(configuration, guid), projectFilePath(), &node.cmd, &node.args);
+
+        nodeByGuid.insert(guid, graph.size());
+        nodeByFile.insert(graphKey(node.projectFile), graph.size());
+        projectIndexes << i;
+        graph << node;
+    }
+
+    // References to projects which are not part of the solution or not built are ignored
+    for (auto n = 0; n < graph.size(); ++n) {
+        auto project = projects.at(projectIndexes.at(n));
+        auto& dependencies = graph[n].dependencies;
+        auto addDependency = [&](int node) {
+            if (node >= 0 && node != n && !dependencies.contains(node)) {
+                dependencies << node;
+            }
+        };
+
+        foreach (const QString& guid, m_projectDependencies.value(m_projectGuids.at(projectIndexes.at(n)))) {
+            addDependency(nodeByGuid.value(guid, -1));
+        }
+        foreach (const QString& filePath, project->projectReferences()) {
+            addDependency(nodeByFile.value(graphKey(filePath), -1));
+        }
+    }
+
+    return graph;
+}
+
+QStringList VsSolutionData::sourceFiles(const VsBuildTarget& target) const
+{
+    auto projects = subProjects();
+    for (auto i = 0; i < projects.size(); ++i) {
+        if (projects.at(i)->projectFilePath().toString() == target.projectFile) {
+            return projects.at(i)->files(projectConfiguration(target.configuration, m_projectGuids.at(i)));
+        }
+    }
+
+    return QStringList();
+}
+
+VsFileSettingsMap VsSolutionData::fileSettings(const VsBuildTarget& target) const
+{
+    auto projects = subProjects();
+    for (auto i = 0; i < projects.size(); ++i) {
+        if (projects.at(i)->projectFilePath().toString() == target.projectFile) {
+            auto projectTarget = target;
+            projectTarget.configuration = projectConfiguration(target.configuration, m_projectGuids.at(i));
+            return projects.at(i)->fileSettings(projectTarget);
+        }
+    }
+
+    return VsFileSettingsMap();
+}
+
+VsBuildTargets VsSolutionData::targets() const
+{
+    VsBuildTargets result;
+    foreach (const QString& configuration, m_configurations) {
+        result << targets(configuration);
+    }
+    return result;
+}
+
+// Each solution configuration builds the active configuration of every project
+VsBuildTargets VsSolutionData::targets(const QString& configuration) const
+{
+    VsBuildTargets result;
+    auto projects = subProjects();
+    for (auto i = 0; i < projects.size(); ++i) {
+        foreach (VsBuildTarget target, projects.at(i)->targets(projectConfiguration(configuration, m_projectGuids.at(i)))) {
+            target.configuration = configuration;
+            result << target;
+        }
+    }
+    return result;
+}
+
+QStringList VsSolutionData::configurations() const
+{
+    return m_configurations;
+}
+
+QStringList VsSolutionData::filesToWatch() const
+{
+    auto files = m_filesToWatch;
+    foreach (const VsProjectData* project, subProjects()) {
+        foreach (const QString& filePath, project->filesToWatch()) {
+            if (!files.contains(filePath)) {
+                files << filePath;
+            }
+        }
+    }
+    return files;
+}
+
+QStringList VsSolutionData::directoriesToWatch() const
+{
+    QStringList directories;
+    foreach (const VsProjectData* project, subProjects()) {
+        foreach (const QString& directory, project->directoriesToWatch()) {
+            if (!directories.contains(directory)) {
+                directories << directory;
+            }
+        }
+    }
+    return directories;
+}
+
+void VsSolutionData::buildCmd(const QString& configuration, QString* cmd, QString* args) const
+{
+    makeCmd(configuration, QString(), *cmd, *args);
+}
+
+void VsSolutionData::cleanCmd(const QString& configuration, QString* cmd, QString* args) const
+{
+    makeCmd(configuration, QLatin1String("/t:Clean"), *cmd, *args);
+}
+
+void VsSolutionData::makeCmd(const QString& configuration, const QString& buildSwitch, QString& cmd, QString& args) const
+{
+    cmd = QLatin1String("%comspec%");
+    auto solutionPath = QDir::toNativeSeparators(projectFilePath().toFileInfo().absoluteFilePath());
+
+    // VS2005 and VS2008 solutions are built by vcbuild
+    if (m_toolsEnvVarName == "VS80COMNTOOLS" || m_toolsEnvVarName == "VS90COMNTOOLS") {
+        auto cfgArg = configuration;
+        cfgArg.replace(QLatin1String("|"), QLatin1String("^|"));
+        if (cfgArg.indexOf(QLatin1Char(' ')) >= 0) {
+            cfgArg = QLatin1String("\"") + cfgArg + QLatin1String("\"");
+        }
+
+        args = QString::fromLatin1("/c \"call \"%1\" & vcbuild \"%2\" /nologo %3%4\"").arg(
+                    m_vcvarsPath,
+                    solutionPath,
+                    buildSwitch.isEmpty() ? QString() : QLatin1String("/Clean "),
+                    cfgArg);
+        return;
+    }
+
+    QString configurationName, platformName;
+    splitConfiguration(configuration, &configurationName, &platformName);
+
+    // Need to clear VISUALSTUDIOVERSION env var, else wrong msbuild might be picked up
+    args = QString::fromLatin1("/c \"set \"VISUALSTUDIOVERSION=\" & call \"%1\" & msbuild \"%2\" /nologo %3 /p:Configuration=\"%4\" /p:Platform=\"%5\"\"").arg(
+                m_vcvarsPath,
+                solutionPath,
+                buildSwitch,
+                configurationName,
+                platformName);
+}
+
+} // namespace Internal
+} // namespace VsProjectManager
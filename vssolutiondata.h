@@ -0,0 +1,104 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#pragma once
+
+#include "vsprojectdata.h"
+
+#include <QSet>
+
+namespace VsProjectManager {
+namespace Internal {
+
+// A project of a solution configuration together with the projects to build before it
+class VsBuildGraphNode
+{
+public:
+    QString name;
+    QString projectFile;
+    QString cmd;
+    QString args;
+    QList<int> dependencies; // indexes of the prerequisite nodes
+};
+
+typedef QList<VsBuildGraphNode> VsBuildGraph;
+
+// A Visual Studio solution shown as one project. The projects of the solution
+// are loaded concurrently and become its sub projects, its targets are those of
+// the projects mapped to the solution configurations, evaluated on demand.
+class VsSolutionData : public VsProjectData
+{
+public:
+    explicit VsSolutionData(const Utils::FileName& solutionFile);
+    VsSolutionData(const Utils::FileName& solutionFile, QDataStream& stream);
+
+public:
+    VsBuildTargets targets() const override;
+    VsBuildTargets targets(const QString& configuration) const override;
+    QStringList configurations() const override;
+    QStringList filesToWatch() const override;
+    QStringList directoriesToWatch() const override;
+    void buildCmd(const QString& configuration, QString* cmd, QString* args) const override;
+    void cleanCmd(const QString& configuration, QString* cmd, QString* args) const override;
+    void save(QDataStream& stream) const override;
+    QStringList sourceFiles(const VsBuildTarget& target) const override;
+    VsFileSettingsMap fileSettings(const VsBuildTarget& target) const override;
+    // Projects built by the solution configuration, ordered by <ProjectReference> items and
+    // solution level dependencies. The graph may contain cycles if the solution is broken.
+    VsBuildGraph buildGraph(const QString& configuration) const;
+
+    // Threads used to load the projects, QTC_VSPROJECTMANAGER_LOAD_THREADS overrides the default
+    static int loaderThreadCount();
+    // Reads the solution configurations only, the projects aren't loaded
+    static QStringList scanConfigurations(const Utils::FileName& solutionFile);
+
+private:
+    struct ProjectEntry
+    {
+        QString guid;
+        QString filePath;
+    };
+
+    QList<ProjectEntry> parse();
+    void loadProjects(const QList<ProjectEntry>& entries);
+    void init(const QByteArray& toolsEnvVarName);
+    QString projectConfiguration(const QString& configuration, const QString& guid) const;
+    bool isBuilt(const QString& configuration, const QString& guid) const;
+    void makeCmd(const QString& configuration, const QString& buildSwitch, QString& cmd, QString& args) const;
+
+private:
+    QByteArray m_toolsEnvVarName;
+    QString m_vcvarsPath;
+    QStringList m_configurations;
+    QStringList m_projectGuids; // by sub project
+    QHash<QString, QString> m_projectConfigurations; // project configuration by solution configuration and guid
+    QSet<QString> m_builtProjects; // solution configuration and guid of projects with a Build.0 entry
+    QHash<QString, QStringList> m_projectDependencies; // guids of the prerequisites by guid
+    QStringList m_filesToWatch; // of the solution itself, the projects add their own
+};
+
+} // namespace Internal
+} // namespace VsProjectManager
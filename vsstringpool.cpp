@@ -0,0 +1,148 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#include "vsstringpool.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+#include <QStringList>
+
+namespace VsProjectManager {
+namespace Internal {
+
+namespace {
+
+// Projects are loaded concurrently, spread the strings over several locks
+const int ShardCount = 16;
+const int MinimumSweepSize = 1024;
+
+template <typename T>
+struct Shard
+{
+    QMutex mutex;
+    QSet<T> strings;
+    int sweepSize = MinimumSweepSize; // the unused strings are released at this size
+    VsStringPool::Statistics statistics;
+};
+
+Shard<QString> s_stringShards[ShardCount];
+Shard<QByteArray> s_byteShards[ShardCount];
+
+qint64 byteSize(const QString& string) { return string.size() * qint64(sizeof(QChar)); }
+qint64 byteSize(const QByteArray& bytes) { return bytes.size(); }
+
+// A string is only referred to by the pool if its buffer isn't shared. Other
+// references can only be taken by intern(), which holds the lock of the shard.
+template <typename T>
+void sweep(Shard<T>& shard)
+{
+    for (auto it = shard.strings.begin(); it != shard.strings.end(); ) {
+        if (it->isDetached()) {
+            ++shard.statistics.releasedStrings;
+            --shard.statistics.uniqueStrings;
+            shard.statistics.uniqueBytes -= byteSize(*it);
+            it = shard.strings.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // Amortized over the insertions, the pool stays within twice the strings in use
+    shard.sweepSize = qMax(MinimumSweepSize, 2 * shard.strings.size());
+}
+
+template <typename T>
+T internInto(Shard<T>* shards, const T& value)
+{
+    if (value.isEmpty()) {
+        return value;
+    }
+
+    auto& shard = shards[qHash(value) % ShardCount];
+    QMutexLocker locker(&shard.mutex);
+    ++shard.statistics.requests;
+
+    auto it = shard.strings.constFind(value);
+    if (it != shard.strings.constEnd()) {
+        ++shard.statistics.hits;
+        shard.statistics.savedBytes += byteSize(value);
+        return *it;
+    }
+
+    ++shard.statistics.uniqueStrings;
+    shard.statistics.uniqueBytes += byteSize(value);
+    shard.strings.insert(value);
+    if (shard.strings.size() >= shard.sweepSize) {
+        sweep(shard);
+    }
+    return value;
+}
+
+template <typename T>
+void addStatistics(Shard<T>* shards, VsStringPool::Statistics& statistics)
+{
+    for (auto i = 0; i < ShardCount; ++i) {
+        QMutexLocker locker(&shards[i].mutex);
+        const auto& shardStatistics = shards[i].statistics;
+        statistics.requests += shardStatistics.requests;
+        statistics.hits += shardStatistics.hits;
+        statistics.uniqueStrings += shardStatistics.uniqueStrings;
+        statistics.uniqueBytes += shardStatistics.uniqueBytes;
+        statistics.savedBytes += shardStatistics.savedBytes;
+        statistics.releasedStrings += shardStatistics.releasedStrings;
+    }
+}
+
+} // anon
+
+QString VsStringPool::intern(const QString& string)
+{
+    return internInto(s_stringShards, string);
+}
+
+QByteArray VsStringPool::intern(const QByteArray& bytes)
+{
+    return internInto(s_byteShards, bytes);
+}
+
+void VsStringPool::intern(QStringList& strings)
+{
+    for (auto& string : strings) {
+        string = intern(string);
+    }
+}
+
+VsStringPool::Statistics VsStringPool::statistics()
+{
+    Statistics statistics;
+    addStatistics(s_stringShards, statistics);
+    addStatistics(s_byteShards, statistics);
+    return statistics;
+}
+
+} // namespace Internal
+} // namespace VsProjectManager
@@ -0,0 +1,65 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+namespace VsProjectManager {
+namespace Internal {
+
+// Thread safe pool of implicitly shared strings. Equal strings returned by
+// intern() share a single buffer, which keeps the paths, include directories
+// and defines repeated across configurations and projects in memory once.
+// Strings nobody but the pool refers to anymore, e.g. those of closed projects,
+// are released as the pool grows.
+class VsStringPool
+{
+public:
+    struct Statistics
+    {
+        qint64 requests = 0;       // calls to intern()
+        qint64 hits = 0;           // requests answered by an already pooled string
+        qint64 uniqueStrings = 0;  // strings held by the pool
+        qint64 uniqueBytes = 0;    // memory used by their contents
+        qint64 savedBytes = 0;     // memory the hits would have used otherwise
+        qint64 releasedStrings = 0;// strings dropped after their last user went away
+
+        // requests per pooled string, 1 means nothing was deduplicated
+        double dedupRatio() const { return uniqueStrings ? double(requests) / uniqueStrings : 1.0; }
+    };
+
+    static QString intern(const QString& string);
+    static QByteArray intern(const QByteArray& bytes);
+    static void intern(QStringList& strings);
+
+    static Statistics statistics();
+};
+
+} // namespace Internal
+} // namespace VsProjectManager
@@ -0,0 +1,287 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+
+#include "vswildcardexpander.h"
+#include "vspathnormalizer.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+#include <QSharedPointer>
+#include <QVector>
+#include <QtConcurrentMap>
+
+namespace VsProjectManager {
+namespace Internal {
+
+namespace {
+
+struct Listing
+{
+    QDateTime lastModified;
+    QStringList files;
+    QStringList directories;
+};
+
+typedef QSharedPointer<const Listing> ListingPtr;
+
+QMutex s_mutex;
+QHash<QString, ListingPtr> s_listings; // by directory
+
+// The modification time of a directory changes whenever entries are added, removed or renamed
+ListingPtr listDirectory(const QString& directory)
+{
+    const auto lastModified = QFileInfo(directory).lastModified();
+    {
+        QMutexLocker locker(&s_mutex);
+        auto it = s_listings.constFind(directory);
+        if (it != s_listings.constEnd() && it.value()->lastModified == lastModified) {
+            return it.value();
+        }
+    }
+
+    QSharedPointer<Listing> listing(new Listing());
+    listing->lastModified = lastModified;
+    QDir dir(directory);
+    listing->files = dir.entryList(QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot);
+    listing->directories = dir.entryList(QDir::Dirs | QDir::Hidden | QDir::NoDotAndDotDot);
+
+    QMutexLocker locker(&s_mutex);
+    s_listings.insert(directory, listing);
+    return listing;
+}
+
+bool isWildcard(QChar c)
+{
+    return c == QLatin1Char('*') || c == QLatin1Char('?');
+}
+
+// Case insensitive like the Windows file system, "*" doesn't cross directories
+bool matches(const QString& pattern, const QString& name)
+{
+    auto p = 0;
+    auto n = 0;
+    auto star = -1;
+    auto starName = 0;
+    while (n < name.size()) {
+        if (p < pattern.size() && (pattern.at(p) == QLatin1Char('?')
+                || pattern.at(p).toCaseFolded() == name.at(n).toCaseFolded())) {
+            ++p;
+            ++n;
+        } else if (p < pattern.size() && pattern.at(p) == QLatin1Char('*')) {
+            star = p++;
+            starName = n;
+        } else if (star >= 0) {
+            p = star + 1;
+            n = ++starName;
+        } else {
+            return false;
+        }
+    }
+
+    while (p < pattern.size() && pattern.at(p) == QLatin1Char('*')) {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+struct Pattern
+{
+    QStringList segments; // below root, the last one matches files
+    QVector<bool> wildcards;
+};
+
+struct WalkTask
+{
+    QString directory;
+    int segment;
+};
+
+struct WalkResult
+{
+    QStringList files;
+    QList<WalkTask> tasks;
+};
+
+// Matches one directory against one segment of the pattern
+struct Visit
+{
+    typedef WalkResult result_type;
+
+    explicit Visit(const Pattern& pattern) : pattern(pattern) { }
+
+    WalkResult operator()(const WalkTask& task) const
+    {
+        WalkResult result;
+        const auto listing = listDirectory(task.directory);
+        const auto& segment = pattern.segments.at(task.segment);
+        const auto prefix = task.directory.endsWith(QLatin1Char('/')) ? task.directory : task.directory + QLatin1Char('/');
+
+        if (segment == QLatin1String("**")) { // zero or more directories
+            result.tasks << WalkTask{ task.directory, task.segment + 1 };
+            for (const auto& name : listing->directories) {
+                result.tasks << WalkTask{ prefix + name, task.segment };
+            }
+        } else if (task.segment + 1 == pattern.segments.size()) {
+            for (const auto& name : listing->files) {
+                if (matches(segment, name)) {
+                    result.files << prefix + name;
+                }
+            }
+        } else if (!pattern.wildcards.at(task.segment)) {
+            result.tasks << WalkTask{ prefix + segment, task.segment + 1 };
+        } else {
+            for (const auto& name : listing->directories) {
+                if (matches(segment, name)) {
+                    result.tasks << WalkTask{ prefix + name, task.segment + 1 };
+                }
+            }
+        }
+
+        return result;
+    }
+
+    const Pattern& pattern;
+};
+
+void expandPattern(const QString& baseDirectory, const QString& spec, QStringList& files, QSet<QString>& directories)
+{
+    const auto path = VsPathNormalizer::absoluteFilePath(baseDirectory, spec);
+    if (!VsWildcardExpander::hasWildcards(path)) {
+        files << path;
+        return;
+    }
+
+    // Everything up to the first segment with wildcards is walked directly
+    auto segments = path.split(QLatin1Char('/'));
+    auto rootSegments = 0;
+    while (rootSegments < segments.size() && !VsWildcardExpander::hasWildcards(segments.at(rootSegments))) {
+        ++rootSegments;
+    }
+
+    // "C:" alone would be the current directory of the drive
+    auto root = segments.mid(0, rootSegments).join(QLatin1Char('/'));
+    if (root.isEmpty() || root.endsWith(QLatin1Char(':'))) {
+        root += QLatin1Char('/');
+    }
+
+    Pattern pattern;
+    pattern.segments = segments.mid(rootSegments);
+    if (pattern.segments.last() == QLatin1String("**")) { // "dir/**" is every file below dir
+        pattern.segments << QStringLiteral("*");
+    }
+    for (const auto& segment : pattern.segments) {
+        pattern.wildcards << VsWildcardExpander::hasWildcards(segment);
+    }
+
+    // Breadth first, the directories of a level are listed concurrently
+    QSet<QPair<QString, int>> visited;
+    QList<WalkTask> level;
+    level << WalkTask{ root, 0 };
+    while (!level.isEmpty()) {
+        QList<WalkTask> tasks;
+        for (const auto& task : level) {
+            if (!visited.contains(qMakePair(task.directory, task.segment))) {
+                visited.insert(qMakePair(task.directory, task.segment));
+                directories.insert(task.directory);
+                tasks << task;
+            }
+        }
+
+        const Visit visit(pattern);
+        QList<WalkResult> results;
+        if (tasks.size() == 1) {
+            results << visit(tasks.first());
+        } else if (!tasks.isEmpty()) {
+            results = QtConcurrent::blockingMapped<QList<WalkResult>>(tasks, visit);
+        }
+
+        level.clear();
+        for (const auto& result : results) {
+            files << result.files;
+            level << result.tasks;
+        }
+    }
+}
+
+} // anon
+
+bool VsWildcardExpander::hasWildcards(const QString& path)
+{
+    for (auto c : path) {
+        if (isWildcard(c)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QStringList VsWildcardExpander::expand(const QString& baseDirectory, const QString& include, const QString& exclude, QStringList* directories)
+{
+    QStringList files;
+    QSet<QString> walked;
+    foreach (const QString& spec, include.split(QLatin1Char(';'), QString::SkipEmptyParts)) {
+        expandPattern(baseDirectory, spec.trimmed(), files, walked);
+    }
+
+    QStringList excludedFiles;
+    foreach (const QString& spec, exclude.split(QLatin1Char(';'), QString::SkipEmptyParts)) {
+        expandPattern(baseDirectory, spec.trimmed(), excludedFiles, walked);
+    }
+
+    QSet<QString> skipped;
+    for (const auto& file : excludedFiles) {
+        skipped.insert(file.toLower());
+    }
+
+    QStringList result;
+    result.reserve(files.size());
+    for (const auto& file : files) {
+        auto key = file.toLower();
+        if (!skipped.contains(key)) {
+            skipped.insert(key);
+            result << file;
+        }
+    }
+
+    if (directories) {
+        for (const auto& directory : walked) {
+            if (!directories->contains(directory)) {
+                *directories << directory;
+            }
+        }
+    }
+
+    return result;
+}
+
+} // namespace Internal
+} // namespace VsProjectManager
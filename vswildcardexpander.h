@@ -0,0 +1,52 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+namespace VsProjectManager {
+namespace Internal {
+
+// Expands MSBuild item specifications with wildcards ("*", "?" and "**") against
+// the file system. Directories matched by "**" are listed in parallel. Listings
+// are cached process wide and read again only once the modification time of a
+// directory changes, so expanding after a change lists just the changed ones.
+class VsWildcardExpander
+{
+public:
+    static bool hasWildcards(const QString& path);
+
+    // include and exclude are ';' separated lists, relative parts are resolved
+    // against baseDirectory. The directories the result depends on are added
+    // to directories, they need to be watched.
+    static QStringList expand(const QString& baseDirectory, const QString& include, const QString& exclude, QStringList* directories = nullptr);
+};
+
+} // namespace Internal
+} // namespace VsProjectManager
@@ -0,0 +1,629 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#include "vsxmltokenizer.h"
+
+#include <QTextCodec>
+#include <QtAlgorithms>
+
+#include <string.h>
+
+#if defined(__AVX2__)
+#   include <immintrin.h>
+#   define VSXML_AVX2
+#   define VSXML_SSE2
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   include <emmintrin.h>
+#   define VSXML_SSE2
+#endif
+
+namespace VsProjectManager {
+namespace Internal {
+
+namespace {
+
+// Returns the first occurrence of any of the four characters in [p, end), or end.
+const char* findFirstOf(const char* p, const char* end, char c0, char c1, char c2, char c3)
+{
+#ifdef VSXML_AVX2
+    const __m256i w0 = _mm256_set1_epi8(c0);
+    const __m256i w1 = _mm256_set1_epi8(c1);
+    const __m256i w2 = _mm256_set1_epi8(c2);
+    const __m256i w3 = _mm256_set1_epi8(c3);
+    for (; end - p >= 32; p += 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i hits = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(chunk, w0), _mm256_cmpeq_epi8(chunk, w1)),
+                    _mm256_or_si256(_mm256_cmpeq_epi8(chunk, w2), _mm256_cmpeq_epi8(chunk, w3)));
+        const quint32 mask = static_cast<quint32>(_mm256_movemask_epi8(hits));
+        if (mask) {
+            return p + qCountTrailingZeroBits(mask);
+        }
+    }
+#endif
+
+#ifdef VSXML_SSE2
+    const __m128i v0 = _mm_set1_epi8(c0);
+    const __m128i v1 = _mm_set1_epi8(c1);
+    const __m128i v2 = _mm_set1_epi8(c2);
+    const __m128i v3 = _mm_set1_epi8(c3);
+    for (; end - p >= 16; p += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i hits = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(chunk, v0), _mm_cmpeq_epi8(chunk, v1)),
+                    _mm_or_si128(_mm_cmpeq_epi8(chunk, v2), _mm_cmpeq_epi8(chunk, v3)));
+        const quint32 mask = static_cast<quint32>(_mm_movemask_epi8(hits));
+        if (mask) {
+            return p + qCountTrailingZeroBits(mask);
+        }
+    }
+#endif
+
+    for (; p < end; ++p) {
+        const char c = *p;
+        if (c == c0 || c == c1 || c == c2 || c == c3) {
+            return p;
+        }
+    }
+
+    return end;
+}
+
+inline const char* findChar(const char* p, const char* end, char c)
+{
+    return findFirstOf(p, end, c, c, c, c);
+}
+
+inline bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+const char* skipSpace(const char* p, const char* end)
+{
+    while (p < end && isSpace(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+bool startsWith(const char* p, const char* end, const char* prefix)
+{
+    const size_t length = strlen(prefix);
+    return static_cast<size_t>(end - p) >= length && memcmp(p, prefix, length) == 0;
+}
+
+bool isAscii(const char* p, const char* end)
+{
+#ifdef VSXML_SSE2
+    for (; end - p >= 16; p += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        if (_mm_movemask_epi8(chunk)) {
+            return false;
+        }
+    }
+#endif
+    for (; p < end; ++p) {
+        if (static_cast<uchar>(*p) >= 0x80) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// MSBuild files are almost entirely ASCII, such runs are narrowed eight code
+// units at a time. Everything else is encoded one code point at a time.
+QByteArray utf16ToUtf8(const uchar* p, const uchar* end, bool bigEndian)
+{
+    end = p + (end - p) / 2 * 2; // a trailing odd byte is dropped
+    QByteArray result;
+    result.resize(static_cast<int>((end - p) / 2 * 3));
+    auto out = reinterpret_cast<uchar*>(result.data());
+    const auto unit = [bigEndian](const uchar* q) -> uint {
+        return bigEndian ? (uint(q[0]) << 8) | q[1] : q[0] | (uint(q[1]) << 8);
+    };
+
+    while (p < end) {
+#ifdef VSXML_SSE2
+        const __m128i nonAscii = _mm_set1_epi16(static_cast<short>(0xFF80));
+        while (end - p >= 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            if (bigEndian) {
+                chunk = _mm_or_si128(_mm_slli_epi16(chunk, 8), _mm_srli_epi16(chunk, 8));
+            }
+            const __m128i ascii = _mm_cmpeq_epi16(_mm_and_si128(chunk, nonAscii), _mm_setzero_si128());
+            if (_mm_movemask_epi8(ascii) != 0xFFFF) {
+                break;
+            }
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(chunk, chunk));
+            out += 8;
+            p += 16;
+        }
+        if (p >= end) {
+            break;
+        }
+#endif
+        auto c = unit(p);
+        p += 2;
+        if (c < 0x80) {
+            *out++ = static_cast<uchar>(c);
+        } else if (c < 0x800) {
+            *out++ = static_cast<uchar>(0xC0 | (c >> 6));
+            *out++ = static_cast<uchar>(0x80 | (c & 0x3F));
+        } else {
+            if (QChar::isHighSurrogate(c) && p < end && QChar::isLowSurrogate(unit(p))) {
+                c = QChar::surrogateToUcs4(static_cast<ushort>(c), static_cast<ushort>(unit(p)));
+                p += 2;
+                *out++ = static_cast<uchar>(0xF0 | (c >> 18));
+                *out++ = static_cast<uchar>(0x80 | ((c >> 12) & 0x3F));
+                *out++ = static_cast<uchar>(0x80 | ((c >> 6) & 0x3F));
+                *out++ = static_cast<uchar>(0x80 | (c & 0x3F));
+                continue;
+            }
+            if (QChar::isSurrogate(c)) { // unpaired
+                c = QChar::ReplacementCharacter;
+            }
+            *out++ = static_cast<uchar>(0xE0 | (c >> 12));
+            *out++ = static_cast<uchar>(0x80 | ((c >> 6) & 0x3F));
+            *out++ = static_cast<uchar>(0x80 | (c & 0x3F));
+        }
+    }
+
+    result.resize(static_cast<int>(out - reinterpret_cast<uchar*>(result.data())));
+    return result;
+}
+
+// Lower case encoding named by the XML declaration, empty if there is none
+QByteArray declaredEncoding(const char* p, const char* end)
+{
+    if (!startsWith(p, end, "<?xml")) {
+        return QByteArray();
+    }
+
+    const QByteArray declaration(p, static_cast<int>(qMin<qint64>(end - p, 256)));
+    const auto close = declaration.indexOf("?>");
+    auto pos = declaration.indexOf("encoding");
+    if (close < 0 || pos < 0 || pos > close) {
+        return QByteArray();
+    }
+
+    pos = declaration.indexOf('=', pos);
+    while (pos >= 0 && pos < close && declaration.at(pos) != '"' && declaration.at(pos) != '\'') {
+        ++pos;
+    }
+    if (pos < 0 || pos >= close) {
+        return QByteArray();
+    }
+
+    const auto valueEnd = declaration.indexOf(declaration.at(pos), pos + 1);
+    return valueEnd < 0 || valueEnd > close ? QByteArray() : declaration.mid(pos + 1, valueEnd - pos - 1).toLower();
+}
+
+VsXmlView trimmed(const char* begin, const char* end)
+{
+    while (begin < end && isSpace(*begin)) {
+        ++begin;
+    }
+    while (end > begin && isSpace(end[-1])) {
+        --end;
+    }
+    return VsXmlView(begin, static_cast<int>(end - begin));
+}
+
+void resolveEntities(QString& text)
+{
+    auto amp = text.indexOf(QLatin1Char('&'));
+    if (amp < 0) {
+        return;
+    }
+
+    QString result;
+    result.reserve(text.size());
+    auto pos = 0;
+    while (amp >= 0) {
+        result += text.midRef(pos, amp - pos);
+        pos = amp;
+        const auto semicolon = text.indexOf(QLatin1Char(';'), amp + 1);
+        if (semicolon < 0) {
+            break;
+        }
+
+        const auto entity = text.midRef(amp + 1, semicolon - amp - 1);
+        if (entity == QLatin1String("lt")) {
+            result += QLatin1Char('<');
+        } else if (entity == QLatin1String("gt")) {
+            result += QLatin1Char('>');
+        } else if (entity == QLatin1String("amp")) {
+            result += QLatin1Char('&');
+        } else if (entity == QLatin1String("quot")) {
+            result += QLatin1Char('"');
+        } else if (entity == QLatin1String("apos")) {
+            result += QLatin1Char('\'');
+        } else if (entity.startsWith(QLatin1Char('#'))) {
+            auto ok = false;
+            const auto hex = entity.startsWith(QLatin1String("#x"));
+            const auto code = text.midRef(amp + (hex ? 3 : 2), semicolon - amp - (hex ? 3 : 2)).toUInt(&ok, hex ? 16 : 10);
+            if (ok && QChar::requiresSurrogates(code)) {
+                result += QChar(QChar::highSurrogate(code));
+                result += QChar(QChar::lowSurrogate(code));
+            } else if (ok) {
+                result += QChar(code);
+            } else {
+                result += text.midRef(amp, semicolon - amp + 1);
+            }
+        } else {
+            result += text.midRef(amp, semicolon - amp + 1);
+        }
+
+        pos = semicolon + 1;
+        amp = text.indexOf(QLatin1Char('&'), pos);
+    }
+
+    result += text.midRef(pos);
+    text = result;
+}
+
+} // namespace
+
+
+////////////////////////////////////////////////////////////////////////////////
+bool VsXmlView::operator==(QLatin1String other) const
+{
+    return m_size == other.size() && memcmp(m_data, other.latin1(), m_size) == 0;
+}
+
+bool VsXmlView::operator==(const QString& other) const
+{
+    for (auto i = 0; i < m_size; ++i) {
+        const auto c = static_cast<uchar>(m_data[i]);
+        if (c >= 0x80 || c == '&') {
+            return toString() == other;
+        }
+
+        if (i >= other.size() || other.at(i).unicode() != c) {
+            return false;
+        }
+    }
+
+    return m_size == other.size();
+}
+
+QString VsXmlView::toString() const
+{
+    auto result = QString::fromUtf8(m_data, m_size);
+    resolveEntities(result);
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+VsXmlView VsXmlAttributes::value(QLatin1String name) const
+{
+    for (const auto& attribute : m_attributes) {
+        if (attribute.name == name) {
+            return attribute.value;
+        }
+    }
+
+    return VsXmlView();
+}
+
+VsXmlView VsXmlAttributes::value(const QString& name) const
+{
+    for (const auto& attribute : m_attributes) {
+        if (attribute.name == name) {
+            return attribute.value;
+        }
+    }
+
+    return VsXmlView();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+VsXmlTokenizer::VsXmlTokenizer(const QString& fileName) :
+    m_file(fileName)
+{
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_errorString = m_file.errorString();
+        return;
+    }
+
+    const auto size = m_file.size();
+    auto data = size > 0 ? m_file.map(0, size) : nullptr;
+    if (!data) {
+        m_errorString = size > 0 ? m_file.errorString() : QStringLiteral("Empty file");
+        return;
+    }
+
+    const auto begin = reinterpret_cast<const char*>(data);
+    const auto end = begin + size;
+
+    // UTF-16 with or without byte order mark, "<" is the first character otherwise
+    const auto b0 = data[0];
+    const auto b1 = size >= 2 ? data[1] : uchar(0xFF);
+    const auto littleEndian = (b0 == 0xFF && b1 == 0xFE) || (b0 == '<' && b1 == 0);
+    const auto bigEndian = (b0 == 0xFE && b1 == 0xFF) || (b0 == 0 && b1 == '<');
+    auto decoded = littleEndian || bigEndian;
+    if (decoded) {
+        m_buffer = utf16ToUtf8(data + (b0 == '<' || b1 == '<' ? 0 : 2), data + size, bigEndian);
+    } else if (!startsWith(begin, end, "\xEF\xBB\xBF")) {
+        // e.g. encoding="Windows-1252", which only matters if there is anything but ASCII
+        const auto encoding = declaredEncoding(begin, end);
+        if (!encoding.isEmpty() && encoding != "utf-8" && encoding != "utf8" && !encoding.startsWith("utf-16")
+                && !isAscii(begin, end)) {
+            auto codec = QTextCodec::codecForName(encoding);
+            if (!codec) {
+                m_errorString = QStringLiteral("Unsupported encoding %1").arg(QString::fromLatin1(encoding));
+                m_file.unmap(data);
+                return;
+            }
+            m_buffer = codec->toUnicode(begin, static_cast<int>(size)).toUtf8();
+            decoded = true;
+        }
+    }
+
+    if (decoded) {
+        m_file.unmap(data);
+        m_begin = m_buffer.constData();
+        m_end = m_begin + m_buffer.size();
+        m_pos = m_begin;
+        return;
+    }
+
+    m_begin = begin;
+    m_end = end;
+    m_pos = startsWith(begin, m_end, "\xEF\xBB\xBF") ? begin + 3 : begin;
+}
+
+QString VsXmlTokenizer::document() const
+{
+    auto begin = startsWith(m_begin, m_end, "\xEF\xBB\xBF") ? m_begin + 3 : m_begin;
+    return QString::fromUtf8(begin, static_cast<int>(m_end - begin));
+}
+
+VsXmlTokenizer::TokenType VsXmlTokenizer::raiseError(const char* message)
+{
+    m_errorString = QString::fromLatin1("%1 at offset %2").arg(QLatin1String(message)).arg(m_pos - m_begin);
+    return m_token = Invalid;
+}
+
+const char* VsXmlTokenizer::skipPast(const char* terminator)
+{
+    const auto length = strlen(terminator);
+    for (auto p = findChar(m_pos, m_end, terminator[0]); p < m_end; p = findChar(p + 1, m_end, terminator[0])) {
+        if (static_cast<size_t>(m_end - p) >= length && memcmp(p, terminator, length) == 0) {
+            return p + length;
+        }
+    }
+
+    return nullptr;
+}
+
+VsXmlTokenizer::TokenType VsXmlTokenizer::readNext()
+{
+    if (m_token == Invalid || m_token == EndDocument || !isOpen()) {
+        return m_token;
+    }
+
+    if (m_pendingEndElement) {
+        m_pendingEndElement = false;
+        return m_token = EndElement;
+    }
+
+    while (m_pos < m_end) {
+        if (*m_pos != '<') {
+            const auto lt = findChar(m_pos, m_end, '<');
+            m_text = VsXmlView(m_pos, static_cast<int>(lt - m_pos));
+            m_cdata = false;
+            m_pos = lt;
+            return m_token = Characters;
+        }
+
+        const auto p = m_pos + 1;
+        if (startsWith(p, m_end, "/")) {
+            return readEndElement();
+        } else if (startsWith(p, m_end, "?")) {
+            const auto next = skipPast("?>");
+            if (!next) {
+                return raiseError("Unterminated processing instruction");
+            }
+            m_pos = next;
+        } else if (startsWith(p, m_end, "!--")) {
+            const auto next = skipPast("-->");
+            if (!next) {
+                return raiseError("Unterminated comment");
+            }
+            m_pos = next;
+        } else if (startsWith(p, m_end, "![CDATA[")) {
+            const auto next = skipPast("]]>");
+            if (!next) {
+                return raiseError("Unterminated CDATA section");
+            }
+            m_text = VsXmlView(p + 8, static_cast<int>(next - 3 - (p + 8)));
+            m_cdata = true;
+            m_pos = next;
+            return m_token = Characters;
+        } else if (startsWith(p, m_end, "!")) { // DOCTYPE and friends
+            const auto next = skipPast(">");
+            if (!next) {
+                return raiseError("Unterminated declaration");
+            }
+            m_pos = next;
+        } else {
+            return readStartElement();
+        }
+    }
+
+    if (m_depth > 0) {
+        return raiseError("Premature end of document");
+    }
+
+    return m_token = EndDocument;
+}
+
+VsXmlTokenizer::TokenType VsXmlTokenizer::readStartElement()
+{
+    auto p = m_pos + 1;
+    auto nameEnd = p;
+    while (nameEnd < m_end && !isSpace(*nameEnd) && *nameEnd != '>' && *nameEnd != '/') {
+        ++nameEnd;
+    }
+
+    if (nameEnd == p) {
+        return raiseError("Expected element name");
+    }
+
+    m_name = VsXmlView(p, static_cast<int>(nameEnd - p));
+    m_attributes.m_attributes.clear();
+
+    for (p = nameEnd; ; ) {
+        p = skipSpace(p, m_end);
+        if (p >= m_end) {
+            return raiseError("Unterminated start tag");
+        }
+
+        if (*p == '>') {
+            m_pos = p + 1;
+            break;
+        }
+
+        if (*p == '/') {
+            if (!startsWith(p, m_end, "/>")) {
+                return raiseError("Expected '>'");
+            }
+            m_pos = p + 2;
+            m_pendingEndElement = true;
+            break;
+        }
+
+        const auto eq = findFirstOf(p, m_end, '=', '>', '<', '"');
+        if (eq >= m_end || *eq != '=') {
+            return raiseError("Expected '=' after attribute name");
+        }
+
+        VsXmlAttributes::Attribute attribute;
+        attribute.name = trimmed(p, eq);
+        p = skipSpace(eq + 1, m_end);
+        if (p >= m_end || (*p != '"' && *p != '\'')) {
+            return raiseError("Expected quoted attribute value");
+        }
+
+        const auto valueEnd = findChar(p + 1, m_end, *p);
+        if (valueEnd >= m_end) {
+            return raiseError("Unterminated attribute value");
+        }
+
+        attribute.value = VsXmlView(p + 1, static_cast<int>(valueEnd - p - 1));
+        m_attributes.m_attributes.append(attribute);
+        p = valueEnd + 1;
+    }
+
+    if (!m_pendingEndElement) {
+        ++m_depth;
+    }
+
+    return m_token = StartElement;
+}
+
+VsXmlTokenizer::TokenType VsXmlTokenizer::readEndElement()
+{
+    const auto p = m_pos + 2;
+    const auto gt = findChar(p, m_end, '>');
+    if (gt >= m_end) {
+        return raiseError("Unterminated end tag");
+    }
+
+    m_name = trimmed(p, gt);
+    m_pos = gt + 1;
+    if (--m_depth < 0) {
+        return raiseError("Unexpected end tag");
+    }
+
+    return m_token = EndElement;
+}
+
+bool VsXmlTokenizer::readNextStartElement()
+{
+    for (;;) {
+        switch (readNext()) {
+        case StartElement:
+            return true;
+        case EndElement:
+        case EndDocument:
+        case Invalid:
+        case NoToken:
+            return false;
+        default:
+            break;
+        }
+    }
+}
+
+void VsXmlTokenizer::skipCurrentElement()
+{
+    auto depth = 1;
+    while (depth) {
+        switch (readNext()) {
+        case StartElement:
+            ++depth;
+            break;
+        case EndElement:
+            --depth;
+            break;
+        case EndDocument:
+        case Invalid:
+        case NoToken:
+            return;
+        default:
+            break;
+        }
+    }
+}
+
+QString VsXmlTokenizer::readElementText(QXmlStreamReader::ReadElementTextBehaviour behaviour)
+{
+    Q_UNUSED(behaviour);
+
+    QString result;
+    if (m_token != StartElement) {
+        return result;
+    }
+
+    for (;;) {
+        switch (readNext()) {
+        case Characters:
+            result += m_cdata ? QString::fromUtf8(m_text.data(), m_text.size()) : m_text.toString();
+            break;
+        case StartElement:
+            skipCurrentElement();
+            break;
+        default:
+            return result;
+        }
+    }
+}
+
+} // namespace Internal
+} // namespace VsProjectManager
@@ -0,0 +1,139 @@
+/**************************************************************************
+**
+** The MIT License (MIT)
+**
+** Copyright (c) 2016 Jean Gressmann
+**
+** Permission is hereby granted, free of charge, to any person obtaining a copy
+** of this software and associated documentation files (the "Software"), to deal
+** in the Software without restriction, including without limitation the rights
+** to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+** copies of the Software, and to permit persons to whom the Software is
+** furnished to do so, subject to the following conditions:
+**
+** The above copyright notice and this permission notice shall be included in all
+** copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+** IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+** FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+** AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+** LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+** OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+** SOFTWARE.
+**
+****************************************************************************/
+
+#pragma once
+
+#include <QFile>
+#include <QLatin1String>
+#include <QString>
+#include <QVarLengthArray>
+#include <QXmlStreamReader>
+
+namespace VsProjectManager {
+namespace Internal {
+
+// Non-owning view of UTF-8 encoded bytes inside a mapped file
+class VsXmlView
+{
+public:
+    VsXmlView() = default;
+    VsXmlView(const char* data, int size) : m_data(data), m_size(size) { }
+
+    const char* data() const { return m_data; }
+    int size() const { return m_size; }
+    bool isEmpty() const { return m_size == 0; }
+
+    bool operator==(QLatin1String other) const;
+    bool operator==(const QString& other) const;
+    bool operator!=(QLatin1String other) const { return !(*this == other); }
+    bool operator!=(const QString& other) const { return !(*this == other); }
+
+    // Decodes UTF-8 and resolves XML entity references
+    QString toString() const;
+
+private:
+    const char* m_data = nullptr;
+    int m_size = 0;
+};
+
+class VsXmlAttributes
+{
+public:
+    bool isEmpty() const { return m_attributes.isEmpty(); }
+    VsXmlView value(QLatin1String name) const;
+    VsXmlView value(const QString& name) const;
+
+private:
+    friend class VsXmlTokenizer;
+    struct Attribute
+    {
+        VsXmlView name;
+        VsXmlView value;
+    };
+
+    QVarLengthArray<Attribute, 8> m_attributes;
+};
+
+// Pull tokenizer for MSBuild files which operates directly on the memory mapped
+// file. It mirrors the subset of the QXmlStreamReader interface used to evaluate
+// project files so that the evaluators can be written once for both. UTF-16
+// files and files declaring another encoding than UTF-8 are decoded to UTF-8
+// up front, ASCII only files are always read in place.
+class VsXmlTokenizer
+{
+public:
+    enum TokenType {
+        NoToken,
+        Invalid,
+        StartElement,
+        EndElement,
+        Characters,
+        EndDocument
+    };
+
+    explicit VsXmlTokenizer(const QString& fileName);
+
+    bool isOpen() const { return m_begin != nullptr; }
+    bool hasError() const { return !m_errorString.isEmpty(); }
+    QString errorString() const { return m_errorString; }
+    // Whole file decoded, for documents that are evaluated on the DOM
+    QString document() const;
+
+    TokenType readNext();
+    TokenType tokenType() const { return m_token; }
+    bool readNextStartElement();
+    void skipCurrentElement();
+    // Only QXmlStreamReader::SkipChildElements is supported
+    QString readElementText(QXmlStreamReader::ReadElementTextBehaviour behaviour = QXmlStreamReader::SkipChildElements);
+
+    VsXmlView name() const { return m_name; }
+    const VsXmlAttributes& attributes() const { return m_attributes; }
+    VsXmlView text() const { return m_text; }
+
+private:
+    TokenType raiseError(const char* message);
+    TokenType readStartElement();
+    TokenType readEndElement();
+    const char* skipPast(const char* terminator);
+
+private:
+    QFile m_file;
+    QByteArray m_buffer; // decoded content if the file isn't read in place
+    const char* m_begin = nullptr;
+    const char* m_end = nullptr;
+    const char* m_pos = nullptr;
+    VsXmlView m_name;
+    VsXmlView m_text;
+    VsXmlAttributes m_attributes;
+    QString m_errorString;
+    TokenType m_token = NoToken;
+    int m_depth = 0;
+    bool m_pendingEndElement = false;
+    bool m_cdata = false;
+};
+
+} // namespace Internal
+} // namespace VsProjectManager